@@ -0,0 +1,52 @@
+// Grid enumeration : multi_dim_counter odometer vs coin::NdRange iterator, for_each and for_each_row
+// make bench && ./benchmark/bench_ndrange
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "coin/algorithm.hpp"
+#include "coin/magic_timer.hpp"
+#include "coin/ndrange.hpp"
+
+template<typename F>
+double ns_per_point(std::uint64_t points, F&& f) {
+    return coin::TimerFunc<std::chrono::duration<double, std::nano>, std::chrono::steady_clock>::exec(f) / static_cast<double>(points);
+}
+
+int main() {
+    const std::vector<int> lower{0, -50, 0, 10};
+    const std::vector<int> upper{39, 49, 99, 89};
+    coin::NdRange<int>    dyn{lower, upper};
+    coin::NdRange<int, 4> fixed{{0, -50, 0, 10}, {39, 49, 99, 89}};
+    auto n = dyn.size();
+
+    std::int64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+    auto counter_ns = ns_per_point(n, [&] {
+        auto p = lower;
+        do { s0 += p[0] ^ p[1] ^ p[2] ^ p[3]; } while (coin::multi_dim_counter(p, lower, upper));
+    });
+    auto iter_ns = ns_per_point(n, [&] {
+        for (auto const& p : dyn) { s1 += p[0] ^ p[1] ^ p[2] ^ p[3]; }
+    });
+    auto fixed_ns = ns_per_point(n, [&] {
+        for (auto const& p : fixed) { s2 += p[0] ^ p[1] ^ p[2] ^ p[3]; }
+    });
+    auto each_ns = ns_per_point(n, [&] {
+        fixed.for_each([&](auto const& p) { s3 += p[0] ^ p[1] ^ p[2] ^ p[3]; });
+    });
+    auto row_ns = ns_per_point(n, [&] {
+        fixed.for_each_row([&](auto const& p, int first, int last) {
+            auto outer = p[0] ^ p[1] ^ p[2];
+            for (int v = first; v <= last; v ++) { s4 += outer ^ v; }
+        });
+    });
+
+    std::cout << n << " points : multi_dim_counter " << counter_ns << " ns/point"
+        << " | NdRange<int> iterator " << iter_ns
+        << " | NdRange<int,4> iterator " << fixed_ns
+        << " | for_each " << each_ns
+        << " | for_each_row " << row_ns
+        << ((s0 == s1 && s1 == s2 && s2 == s3 && s3 == s4) ? "" : "  MISMATCH") << "\n";
+}
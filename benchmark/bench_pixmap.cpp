@@ -0,0 +1,56 @@
+// Saving and opening a 4K PPM/PGM with pixmap : plain text (P2/P3) against raw binary (P5/P6),
+// and the plain text raster through std::ostream_iterator / std::istream_iterator for reference
+// make bench && ./benchmark/bench_pixmap [directory]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+
+#include "coin/magic_timer.hpp"
+#include "coin/pixmap.hpp"
+
+// exec(f) : seconds spent in f()
+using bench_timer = coin::TimerFunc<std::chrono::duration<double>, std::chrono::steady_clock>;
+
+template<pixmap::Anymap P, pixmap::Format F>
+void run(const std::string& name, const std::string& filename, std::size_t width, std::size_t height, std::uint16_t max_val) {
+    using image = pixmap::Image<P, F>;
+    std::mt19937 gen{7};
+    typename image::data_storage data(width * height * (P == pixmap::Anymap::PPM ? 3 : 1));
+    for (auto& v : data) { v = static_cast<std::uint16_t>(gen() % (max_val + 1u)); }
+    image img{data, width, height, max_val};
+    image back;
+    auto save = bench_timer::exec([&] { img.save(filename); });
+    auto open = bench_timer::exec([&] { back = pixmap::open<P, F>(filename); });
+    bool ok = std::equal(img.begin(), img.end(), back.begin()) && back.width() == width && back.height() == height;
+    std::cout << name << " : save " << save << " s, open " << open << " s" << (ok ? "" : "  MISMATCH");
+    if (F == pixmap::Format::ASCII) {
+        std::vector<std::uint16_t> raster;
+        auto ios_save = bench_timer::exec([&] {
+            std::ofstream ofs{filename};
+            std::copy(data.begin(), data.end(), std::ostream_iterator<std::uint16_t>(ofs, " "));
+        });
+        auto ios_open = bench_timer::exec([&] {
+            std::ifstream ifs{filename};
+            std::copy(std::istream_iterator<std::uint16_t>(ifs), std::istream_iterator<std::uint16_t>(), std::back_inserter(raster));
+        });
+        std::cout << " | iostream : save " << ios_save << " s, open " << ios_open << " s";
+    }
+    std::cout << "\n";
+    std::remove(filename.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+    using pixmap::Anymap;
+    using pixmap::Format;
+    run<Anymap::PPM, Format::ASCII>("PPM 3840x2160 8 bit ASCII ", dir + "/bench_ascii.ppm", 3840, 2160, 255);
+    run<Anymap::PPM, Format::BIN>  ("PPM 3840x2160 8 bit BIN   ", dir + "/bench_bin.ppm", 3840, 2160, 255);
+    run<Anymap::PGM, Format::ASCII>("PGM 3840x2160 16 bit ASCII", dir + "/bench_ascii.pgm", 3840, 2160, 65535);
+    run<Anymap::PGM, Format::BIN>  ("PGM 3840x2160 16 bit BIN  ", dir + "/bench_bin.pgm", 3840, 2160, 65535);
+}
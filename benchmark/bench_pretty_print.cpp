@@ -0,0 +1,47 @@
+// Pretty print of large containers : coin::to_string, coin::print_to into a reused buffer, operator<< to a stream
+// make bench && ./benchmark/bench_pretty_print
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "coin/magic_timer.hpp"
+#include "coin/pretty_print.hpp"
+
+// exec(f) : seconds spent in f()
+using bench_timer = coin::TimerFunc<std::chrono::duration<double>, std::chrono::steady_clock>;
+
+template<typename T>
+void run(const std::string& name, const T& cont) {
+    using coin::operator<<;
+    std::size_t bytes = 0;
+    auto str_s = bench_timer::exec([&] { bytes = coin::to_string(cont).size(); });
+    std::string buffer;
+    coin::print_to(buffer, cont); // warm up : the buffer keeps its capacity
+    auto buf_s = bench_timer::exec([&] { buffer.clear(); coin::print_to(buffer, cont); });
+    std::ofstream null{"/dev/null"};
+    auto os_s = bench_timer::exec([&] { null << cont; });
+    std::cout << name << " (" << bytes << " bytes) : to_string " << str_s << " s"
+        << " | print_to reused buffer " << buf_s << " s"
+        << " | operator<< " << os_s << " s\n";
+}
+
+int main() {
+    std::mt19937_64 gen{5};
+    std::vector<int> ints(10000000);
+    for (auto& x : ints) { x = static_cast<int>(gen()); }
+    run("vector<int> 10M", ints);
+
+    std::vector<double> doubles(2000000);
+    for (auto& x : doubles) { x = static_cast<double>(gen() % 1000000) / 7.; }
+    run("vector<double> 2M", doubles);
+
+    std::map<std::string, std::int64_t> m;
+    for (int i = 0; i < 500000; i ++) { m["key" + std::to_string(i)] = static_cast<std::int64_t>(gen()); }
+    run("map<string,int64> 500k", m);
+}
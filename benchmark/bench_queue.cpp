@@ -0,0 +1,106 @@
+// Throughput and latency of coin::spsc_queue / coin::mpmc_queue and their blocking
+// variants against a mutex protected std::deque fed through coin::semaphore.
+// make bench && ./benchmark/bench_queue
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coin/magic_timer.hpp"
+#include "coin/queue.hpp"
+#include "coin/semaphore.hpp"
+
+// stop() : nanoseconds since construction
+using bench_timer = coin::Timer<coin::LogLevel::log_debug, std::chrono::duration<double, std::nano>, std::chrono::steady_clock>;
+
+// the baseline this replaces in the ingest stage
+template<typename T>
+class locked_queue {
+public:
+    using value_type = T;
+    explicit locked_queue(std::size_t) {}
+    void push(T v) {
+        { std::lock_guard<std::mutex> lock{mutex_}; queue_.push_back(std::move(v)); }
+        items_.notify();
+    }
+    void pop(T& out) {
+        items_.wait();
+        std::lock_guard<std::mutex> lock{mutex_};
+        out = std::move(queue_.front());
+        queue_.pop_front();
+    }
+private:
+    std::mutex      mutex_;
+    std::deque<T>   queue_;
+    coin::semaphore items_;
+};
+
+template<typename Queue>
+double throughput(int producers, int consumers, long items) {
+    Queue queue(1024);
+    auto per_producer = items / producers;
+    auto total = per_producer * producers;
+    bench_timer timer;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p ++) {
+        threads.emplace_back([&] { for (long i = 0; i < per_producer; i ++) { queue.push(i); } });
+    }
+    for (int c = 0; c < consumers; c ++) {
+        auto share = total / consumers + (c < total % consumers ? 1 : 0);
+        threads.emplace_back([&queue, share] { long v; for (long i = 0; i < share; i ++) { queue.pop(v); } });
+    }
+    for (auto& t : threads) { t.join(); }
+    return total / timer.stop() * 1e3;
+}
+
+template<typename Queue>
+double round_trip(int rounds) {
+    Queue ping(16), pong(16);
+    std::thread other([&] { long v; for (int i = 0; i < rounds; i ++) { ping.pop(v); pong.push(v); } });
+    bench_timer timer;
+    long v;
+    for (int i = 0; i < rounds; i ++) { ping.push(i); pong.pop(v); }
+    auto elapsed = timer.stop();
+    other.join();
+    return elapsed / rounds;
+}
+
+template<typename Queue>
+void run(const std::string& name, bool single_producer_consumer) {
+    std::cout << name << "\n";
+    std::cout << "  round trip    : " << round_trip<Queue>(100000) << " ns\n";
+    std::cout << "  1 x 1         : " << throughput<Queue>(1, 1, 4000000) << " Mitems/s\n";
+    if (single_producer_consumer) { return; }
+    for (int n : {2, 4, 8}) {
+        std::cout << "  " << n << " x " << n << "         : " << throughput<Queue>(n, n, 4000000) << " Mitems/s\n";
+    }
+}
+
+int main() {
+    run<locked_queue<long>>("mutex + std::deque + coin::semaphore", false);
+    run<coin::blocking_spsc_queue<long>>("coin::blocking_spsc_queue", true);
+    run<coin::blocking_mpmc_queue<long>>("coin::blocking_mpmc_queue", false);
+
+    coin::spsc_queue<long> spsc(1024);
+    std::vector<long> batch(64), out(64);
+    long moved = 0;
+    bench_timer timer;
+    std::thread producer([&] {
+        for (long sent = 0; sent < 4000000; ) {
+            auto n = spsc.try_push_n(batch.begin(), batch.size());
+            if (n == 0) { std::this_thread::yield(); }
+            sent += n;
+        }
+    });
+    while (moved < 4000000) {
+        auto n = spsc.try_pop_n(out.begin(), out.size());
+        if (n == 0) { std::this_thread::yield(); }
+        moved += n;
+    }
+    producer.join();
+    std::cout << "coin::spsc_queue batches of 64 (non blocking) : " << moved / timer.stop() * 1e3 << " Mitems/s\n";
+}
@@ -0,0 +1,76 @@
+// Dedupe benchmark : std::sort + unique vs coin::remove_duplicate (radix sort for integers)
+// vs coin::remove_duplicate(keep_order) (flat hash set) vs a std::unordered_set stable baseline,
+// over several key types and duplicate ratios.
+// make bench && ./benchmark/bench_remove_duplicate
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "coin/algorithm.hpp"
+#include "coin/magic_timer.hpp"
+
+template<typename T> T make_key(std::uint64_t x);
+template<> std::int32_t  make_key<std::int32_t>(std::uint64_t x)  { return static_cast<std::int32_t>(x * 2654435761u); }
+template<> std::uint64_t make_key<std::uint64_t>(std::uint64_t x) { return x * 0x9E3779B97F4A7C15ULL; }
+template<> std::string   make_key<std::string>(std::uint64_t x)   { return "user-" + std::to_string(x * 7919); }
+
+template<typename T>
+std::vector<T> make_input(std::size_t n, double dup_ratio) {
+    auto distinct = std::max<std::size_t>(1, static_cast<std::size_t>(n * (1. - dup_ratio)));
+    std::mt19937_64 gen{42};
+    std::vector<T> v;
+    v.reserve(n);
+    for (std::size_t i = 0; i < n; i ++) { v.push_back(make_key<T>(gen() % distinct)); }
+    return v;
+}
+
+template<typename T, typename F>
+double measure(const std::vector<T>& input, F&& f) {
+    double best = 1e300;
+    for (int rep = 0; rep < 3; rep ++) {
+        auto v = input;
+        coin::Timer<coin::LogLevel::log_debug, std::chrono::duration<double, std::milli>, std::chrono::steady_clock> timer;
+        f(v);
+        best = std::min(best, timer.stop());
+    }
+    return best;
+}
+
+template<typename T>
+void run(const std::string& name, std::size_t n) {
+    std::cout << name << " (" << n << " keys)\n";
+    std::cout << "  dup ratio | sort+unique | remove_duplicate | keep_order | unordered_set\n";
+    for (double dup : {0., 0.5, 0.9, 0.99}) {
+        auto input = make_input<T>(n, dup);
+        auto sort_unique = measure(input, [](std::vector<T>& v) {
+            std::sort(v.begin(), v.end());
+            v.erase(std::unique(v.begin(), v.end()), v.end());
+        });
+        auto coin_sorted = measure(input, [](std::vector<T>& v) { coin::remove_duplicate(v); });
+        auto coin_stable = measure(input, [](std::vector<T>& v) { coin::remove_duplicate(v, coin::keep_order); });
+        auto std_stable  = measure(input, [](std::vector<T>& v) {
+            std::unordered_set<T> seen;
+            seen.reserve(v.size());
+            v.erase(std::remove_if(v.begin(), v.end(), [&](const T& x) { return !seen.insert(x).second; }), v.end());
+        });
+        std::cout << std::fixed << std::setprecision(1)
+            << "  " << std::setw(9) << dup * 100 << "%"
+            << " | " << std::setw(8) << sort_unique << " ms"
+            << " | " << std::setw(13) << coin_sorted << " ms"
+            << " | " << std::setw(7) << coin_stable << " ms"
+            << " | " << std::setw(10) << std_stable << " ms\n";
+    }
+}
+
+int main() {
+    run<std::int32_t>("int32", 4000000);
+    run<std::uint64_t>("uint64", 4000000);
+    run<std::string>("string", 1000000);
+}
@@ -0,0 +1,39 @@
+// Reverse index build : std::unordered_map vs coin::flat_hash_map, serial and partitioned
+// make bench && ./benchmark/bench_reverse_index
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "coin/magic_timer.hpp"
+#include "coin/parallel_algorithm.hpp"
+
+// exec(f) : seconds spent in f()
+using bench_timer = coin::TimerFunc<std::chrono::duration<double>, std::chrono::steady_clock>;
+
+template<typename T>
+void run(const std::string& name, const std::vector<T>& v) {
+    std::size_t s0 = 0, s1 = 0, s2 = 0;
+    auto std_s  = bench_timer::exec([&] { s0 = coin::create_reverse_index(v).size(); });
+    auto flat_s = bench_timer::exec([&] { s1 = coin::create_flat_reverse_index(v).size(); });
+    auto par_s  = bench_timer::exec([&] { s2 = coin::create_flat_reverse_index(coin::par, v).size(); });
+    std::cout << name << " " << v.size() << " values, " << s0 << " keys : std::unordered_map " << std_s << " s"
+        << " | flat_hash_map " << flat_s << " s"
+        << " | flat_hash_map par " << par_s << " s"
+        << ((s0 == s1 && s1 == s2) ? "" : "  MISMATCH") << "\n";
+}
+
+int main() {
+    std::mt19937_64 gen{3};
+    for (std::size_t n : {std::size_t{1} << 16, std::size_t{1} << 20, std::size_t{1} << 23}) {
+        std::vector<std::uint64_t> ints(n);
+        for (auto& x : ints) { x = gen() % (n / 2); }
+        run("uint64", ints);
+    }
+    std::vector<std::string> strings(std::size_t{1} << 20);
+    for (auto& s : strings) { s = "ticker_" + std::to_string(gen() % 500000); }
+    run("string", strings);
+}
@@ -0,0 +1,56 @@
+// Sorted array search : std::lower_bound vs coin::StaticBTree (one query at a time and batched)
+// make bench && ./benchmark/bench_search
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "coin/magic_timer.hpp"
+#include "coin/static_btree.hpp"
+
+template<typename F>
+double ns_per_query(std::size_t queries, F&& f) {
+    return coin::TimerFunc<std::chrono::duration<double, std::nano>, std::chrono::steady_clock>::exec(f) / static_cast<double>(queries);
+}
+
+template<typename T>
+void run(const std::string& name, std::size_t n, std::size_t queries) {
+    std::mt19937_64 gen{7};
+    std::vector<T> keys(n);
+    for (auto& k : keys) { k = static_cast<T>(gen()); }
+    std::sort(keys.begin(), keys.end());
+    std::vector<T> q(queries);
+    for (auto& x : q) { x = static_cast<T>(gen()); }
+
+    coin::StaticBTree<T> index(keys);
+    std::vector<std::size_t> expected(queries), out(queries);
+    bool mismatch = false;
+
+    auto std_ns = ns_per_query(queries, [&] {
+        for (std::size_t i = 0; i < queries; i ++) { expected[i] = std::lower_bound(keys.begin(), keys.end(), q[i]) - keys.begin(); }
+    });
+    auto tree_ns = ns_per_query(queries, [&] {
+        for (std::size_t i = 0; i < queries; i ++) { out[i] = index.lower_bound_index(q[i]); }
+    });
+    mismatch |= out != expected;
+    auto batch_ns = ns_per_query(queries, [&] {
+        index.lower_bound_indices(q.begin(), q.end(), out.begin());
+    });
+    mismatch |= out != expected;
+
+    std::cout << name << " " << n << " keys : std::lower_bound " << std_ns << " ns/query"
+        << " | StaticBTree " << tree_ns << " ns/query"
+        << " | batched " << batch_ns << " ns/query"
+        << (mismatch ? "  MISMATCH" : "") << "\n";
+}
+
+int main() {
+    for (std::size_t n : {std::size_t{1} << 12, std::size_t{1} << 20, std::size_t{1} << 24}) {
+        run<std::uint32_t>("uint32", n, 2000000);
+        run<std::uint64_t>("uint64", n, 2000000);
+    }
+}
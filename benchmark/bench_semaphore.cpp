@@ -0,0 +1,58 @@
+// Contention benchmark : coin::semaphore (mutex + condvar) vs coin::lightweight_semaphore
+// make bench && ./benchmark/bench_semaphore
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coin/magic_timer.hpp"
+#include "coin/semaphore.hpp"
+
+// stop() : nanoseconds since construction
+using bench_timer = coin::Timer<coin::LogLevel::log_debug, std::chrono::duration<double, std::nano>, std::chrono::steady_clock>;
+
+template<typename Semaphore>
+double ping_pong(int rounds) {
+    Semaphore ping, pong;
+    bench_timer timer;
+    std::thread other([&] {
+        for (int i = 0; i < rounds; i ++) { ping.wait(); pong.notify(); }
+    });
+    for (int i = 0; i < rounds; i ++) { ping.notify(); pong.wait(); }
+    other.join();
+    return timer.stop() / rounds;
+}
+
+template<typename Semaphore>
+double producers_consumers(int producers, int consumers, int items_per_producer) {
+    Semaphore items;
+    auto total = producers * items_per_producer;
+    bench_timer timer;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p ++) {
+        threads.emplace_back([&] { for (int i = 0; i < items_per_producer; i ++) { items.notify(); } });
+    }
+    for (int c = 0; c < consumers; c ++) {
+        auto share = total / consumers + (c < total % consumers ? 1 : 0);
+        threads.emplace_back([&items, share] { for (int i = 0; i < share; i ++) { items.wait(); } });
+    }
+    for (auto& t : threads) { t.join(); }
+    return timer.stop() / total;
+}
+
+template<typename Semaphore>
+void run(const std::string& name) {
+    std::cout << name << "\n";
+    std::cout << "  ping-pong          : " << ping_pong<Semaphore>(200000) << " ns/hand-off\n";
+    for (int n : {1, 2, 4, 8}) {
+        std::cout << "  " << n << " prod x " << n << " cons : "
+            << producers_consumers<Semaphore>(n, n, 1000000 / n) << " ns/item\n";
+    }
+}
+
+int main() {
+    run<coin::semaphore>("coin::semaphore");
+    run<coin::lightweight_semaphore>("coin::lightweight_semaphore");
+}
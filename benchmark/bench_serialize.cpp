@@ -0,0 +1,57 @@
+// Serialization throughput on nested payloads : coin::to_binary / from_binary and to_json / from_json
+// make bench && ./benchmark/bench_serialize
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "coin/magic_timer.hpp"
+#include "coin/serialize.hpp"
+
+// exec(f) : seconds spent in f()
+using bench_timer = coin::TimerFunc<std::chrono::duration<double>, std::chrono::steady_clock>;
+
+template<typename T>
+void run(const std::string& name, const T& payload) {
+    std::string binary, json;
+    T back;
+    auto bin_w  = bench_timer::exec([&] { binary = coin::to_binary(payload); });
+    auto bin_r  = bench_timer::exec([&] { back = coin::from_binary<T>(binary); });
+    bool ok = back == payload;
+    auto json_w = bench_timer::exec([&] { json = coin::to_json(payload); });
+    auto json_r = bench_timer::exec([&] { back = coin::from_json<T>(json); });
+    ok = ok && back == payload;
+    auto mb = [](std::size_t bytes, double s) { return static_cast<double>(bytes) / s / 1e6; };
+    std::cout << name << " : binary " << binary.size() / 1000 << " kB, write " << mb(binary.size(), bin_w) << " MB/s, read " << mb(binary.size(), bin_r) << " MB/s"
+        << " | json " << json.size() / 1000 << " kB, write " << mb(json.size(), json_w) << " MB/s, read " << mb(json.size(), json_r) << " MB/s"
+        << (ok ? "" : "  MISMATCH") << "\n";
+}
+
+int main() {
+    std::mt19937_64 gen{11};
+
+    std::vector<std::vector<double>> matrix(2000, std::vector<double>(1000));
+    for (auto& row : matrix) { for (auto& x : row) { x = static_cast<double>(gen() % 100000) / 64.; } }
+    run("vector<vector<double>> 2000x1000", matrix);
+
+    std::vector<std::vector<std::int32_t>> ints(2000, std::vector<std::int32_t>(1000));
+    for (auto& row : ints) { for (auto& x : row) { x = static_cast<std::int32_t>(gen() % 2000) - 1000; } }
+    run("vector<vector<int32>> 2000x1000", ints);
+
+    std::map<std::string, std::vector<std::int64_t>> series;
+    for (int i = 0; i < 20000; i ++) {
+        auto& v = series["ticker_" + std::to_string(i)];
+        for (int k = 0; k < 50; k ++) { v.push_back(static_cast<std::int64_t>(gen() % 1000000)); }
+    }
+    run("map<string,vector<int64>> 20000x50", series);
+
+    std::vector<std::map<std::int32_t, std::pair<std::string, double>>> records(1000);
+    for (auto& r : records) {
+        for (int k = 0; k < 100; k ++) { r[static_cast<std::int32_t>(gen() % 100000)] = {"name" + std::to_string(k), static_cast<double>(k) / 3.}; }
+    }
+    run("vector<map<int32,pair<string,double>>> 1000x100", records);
+}
@@ -50,6 +50,16 @@ void demo_timer_and_random() {
 }
 
 
+void demo_latency_histogram() {
+	coin::LatencyHistogram<> hist;
+	for (int i = 0; i < 100; i ++) {
+		coin::TimerScope<coin::LogLevel::log_debug, std::chrono::microseconds> timer{hist}; // record into hist instead of logging
+		std::this_thread::sleep_for(std::chrono::microseconds(50 + i));
+	}
+	std::cout << hist.to_string() << std::endl;
+}
+
+
 void demo_vector_smart_ptr() {
 	std::vector<int> v(6);
 	std::generate(v.begin(), v.end(), [](){static int n{1}; return n ++;});
@@ -141,6 +151,7 @@ void demo_matrix() {
 int main() {
 	demo_pretty_print();
 	demo_timer_and_random();
+	demo_latency_histogram();
 	demo_vector_smart_ptr();
 	demo_compile_time();
 	demo_functional();
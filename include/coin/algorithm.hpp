@@ -9,10 +9,18 @@
 #include <algorithm>
 #include <functional>
 #include <chrono>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include "logger.hpp"
 #include "except.hpp"
 #include "debug.hpp"
+#include "flat_hash.hpp"
+#include "flat_map.hpp"
+#include "simd_find.hpp"
+#include "static_btree.hpp"
 
 namespace coin {
     
@@ -29,13 +37,126 @@ std::vector<T> make_vector_from_array(const T (&data)[N]) {
     return std::vector<T>(data, data+N);
 }
 
+namespace _detail {
+
+//! LSD radix sort, one byte per pass, passes where every key has the same byte are skipped
+template<typename T, typename Alloc>
+void radix_sort(std::vector<T,Alloc>& v) {
+    using U = std::make_unsigned_t<T>;
+    constexpr U sign_flip = std::is_signed<T>::value ? U(U(1) << (sizeof(T) * 8 - 1)) : U(0);
+    auto key = [](T x) { return static_cast<U>(static_cast<U>(x) ^ sign_flip); };
+
+    std::vector<std::size_t> counts(sizeof(T) * 256, 0);
+    for (auto x : v) {
+        auto k = key(x);
+        for (std::size_t d = 0; d < sizeof(T); d ++) { ++ counts[d * 256 + ((k >> (d * 8)) & 0xff)]; }
+    }
+    std::vector<T,Alloc> buffer(v.size());
+    for (std::size_t d = 0; d < sizeof(T); d ++) {
+        auto c = counts.data() + d * 256;
+        if (c[(key(v[0]) >> (d * 8)) & 0xff] == v.size()) { continue; }
+        std::size_t offset = 0;
+        for (std::size_t b = 0; b < 256; b ++) { auto n = c[b]; c[b] = offset; offset += n; }
+        for (auto x : v) { buffer[c[(key(x) >> (d * 8)) & 0xff] ++] = x; }
+        v.swap(buffer);
+    }
+}
+
 template<typename Container>
-void remove_duplicate(Container& cont) {
+void sort_unique(Container& cont, std::false_type) {
     using std::begin; using std::end;
     std::sort(begin(cont), end(cont));
     cont.erase(unique(begin(cont), end(cont)), end(cont));
 }
 
+template<typename Container>
+void sort_unique(Container& cont, std::true_type) {
+    if (cont.size() < 256) { return sort_unique(cont, std::false_type{}); }
+    radix_sort(cont);
+    cont.erase(std::unique(cont.begin(), cont.end()), cont.end());
+}
+
+template<typename Container>
+struct is_radix_sortable : std::false_type {};
+
+template<typename T, typename Alloc>
+struct is_radix_sortable<std::vector<T,Alloc>>
+    : std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value> {};
+
+template<typename T>
+void exist_many_hashed(const std::vector<T>& haystack, const std::vector<T>& needles, std::vector<bool>& found) {
+    flat_hash_set<T> set(haystack.size());
+    for (auto const& v : haystack) { set.insert(v); }
+    for (size_t i = 0; i < needles.size(); i ++) { found[i] = set.contains(needles[i]); }
+}
+
+template<typename T>
+void exist_many_indexed(const std::vector<T>& haystack, const std::vector<T>& needles, std::vector<bool>& found, std::false_type) {
+    exist_many_hashed(haystack, needles, found);
+}
+
+// integers : one bit per value when the range is at most 64 bits per element
+template<typename T>
+void exist_many_indexed(const std::vector<T>& haystack, const std::vector<T>& needles, std::vector<bool>& found, std::true_type) {
+    auto mm = std::minmax_element(haystack.begin(), haystack.end());
+    using U = std::make_unsigned_t<T>;
+    auto lo = *mm.first;
+    auto range = static_cast<std::uint64_t>(static_cast<U>(*mm.second) - static_cast<U>(lo));
+    if (range / 64 > haystack.size()) {
+        return exist_many_hashed(haystack, needles, found);
+    }
+    std::vector<std::uint64_t> bits(range / 64 + 1, 0);
+    for (auto v : haystack) {
+        auto k = static_cast<std::uint64_t>(static_cast<U>(v) - static_cast<U>(lo));
+        bits[k >> 6] |= std::uint64_t{1} << (k & 63);
+    }
+    for (size_t i = 0; i < needles.size(); i ++) {
+        auto v = needles[i];
+        if (v < lo || *mm.second < v) { continue; }
+        auto k = static_cast<std::uint64_t>(static_cast<U>(v) - static_cast<U>(lo));
+        found[i] = (bits[k >> 6] >> (k & 63)) & 1;
+    }
+}
+
+} // ns _detail
+
+//! Sort and remove the duplicates (radix sort for vectors of integers)
+template<typename Container>
+void remove_duplicate(Container& cont) {
+    _detail::sort_unique(cont, _detail::is_radix_sortable<Container>{});
+}
+
+struct keep_order_t {};
+constexpr keep_order_t keep_order{};
+
+//! Remove the duplicates keeping the first occurrences in their original order.
+//! O(n) with a flat_hash_set of the indices of the kept elements : no key is copied.
+template<typename Container>
+void remove_duplicate(Container& cont, keep_order_t) {
+    using value_type = typename Container::value_type;
+    struct IndexHash {
+        const Container* c;
+        std::size_t operator()(std::size_t i) const { return std::hash<value_type>{}((*c)[i]); }
+    };
+    struct IndexEqual {
+        const Container* c;
+        bool operator()(std::size_t a, std::size_t b) const { return (*c)[a] == (*c)[b]; }
+    };
+    flat_hash_set<std::size_t, IndexHash, IndexEqual> seen(0, IndexHash{&cont}, IndexEqual{&cont});
+
+    std::hash<value_type> hasher;
+    std::size_t w = 0;
+    for (std::size_t i = 0; i < cont.size(); i ++) {
+        auto h = _impl_flat_hash::mix_hash(hasher(cont[i]));
+        seen.emplace_hashed(h, [&](std::size_t j) { return cont[j] == cont[i]; }, [&](void* slot) {
+            if (w != i) { cont[w] = std::move(cont[i]); }
+            new (slot) std::size_t(w ++);
+        });
+    }
+    using std::begin;
+    cont.erase(begin(cont) + w, cont.end());
+}
+
 template<typename T, typename Alloc>
 void remove_element(std::vector<T,Alloc> vec, const T& element) {
     vec.erase(std::remove(vec.begin(), vec.end(), element), vec.end());
@@ -68,16 +189,29 @@ void remove_element(std::map<K,T,Comp,Alloc>& m, const K& k) {
 }
 
 template<class ForwardIt, class T>
-T lower_bound_index(ForwardIt first, ForwardIt last, const T& value) {
-    return (std::lower_bound (first, last, value) - first);
+size_t lower_bound_index(ForwardIt first, ForwardIt last, const T& value) {
+    return static_cast<size_t>(std::distance(first, std::lower_bound(first, last, value)));
 }
 
 template<class ForwardIt, class T>
-T upper_bound_index(ForwardIt first, ForwardIt last, const T& value) {
-    return (std::upper_bound (first, last, value) - first);
+size_t upper_bound_index(ForwardIt first, ForwardIt last, const T& value) {
+    return static_cast<size_t>(std::distance(first, std::upper_bound(first, last, value)));
+}
+
+//! Same indices through a StaticBTree built once from the sorted range (for many searches in large arrays)
+template<class T, class Compare, size_t B>
+size_t lower_bound_index(const StaticBTree<T, Compare, B>& index, const T& value) {
+    return index.lower_bound_index(value);
+}
+
+template<class T, class Compare, size_t B>
+size_t upper_bound_index(const StaticBTree<T, Compare, B>& index, const T& value) {
+    return index.upper_bound_index(value);
 }
 
 
+//! Odometer step over the box [lower, upper] (bounds included), false after the last point.
+//! See coin::NdRange for iterators, random access and splitting of the same enumeration.
 template<typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
 bool multi_dim_counter(std::vector<T>& v, const std::vector<T>& lower, const std::vector<T>& upper) {
     assert(v.size() == lower.size());
@@ -98,6 +232,18 @@ template<class Container>
 auto create_reverse_index(const Container& cont) 
 -> std::unordered_map<typename Container::value_type, size_t> {
     auto reverse_index = std::unordered_map<typename Container::value_type, size_t>{};
+    reverse_index.reserve(cont.size());
+    for (size_t i = 0; i < cont.size(); i ++) {
+        reverse_index[cont[i]] = i;
+    }
+    return reverse_index;
+}
+
+//! Same mapping in a coin::flat_hash_map (elements inline, no node allocation), sized once for cont.size() keys
+template<class Container>
+auto create_flat_reverse_index(const Container& cont)
+-> flat_hash_map<typename Container::value_type, size_t> {
+    auto reverse_index = flat_hash_map<typename Container::value_type, size_t>(cont.size());
     for (size_t i = 0; i < cont.size(); i ++) {
         reverse_index[cont[i]] = i;
     }
@@ -105,11 +251,72 @@ auto create_reverse_index(const Container& cont)
 }
 
 
+namespace _detail {
+
 template<class InputIterator, class T>
-bool exist(InputIterator first, InputIterator last, const T& val) {
+bool exist_range(InputIterator first, InputIterator last, const T& val, std::false_type /*simd*/) {
     return std::find(first, last, val) != last;
 }
 
+template<class ContiguousIterator, class T>
+bool exist_range(ContiguousIterator first, ContiguousIterator last, const T& val, std::true_type /*simd*/) {
+    if (first == last) {
+        return false;
+    }
+    auto p = &*first;
+    auto e = p + (last - first);
+    return find_contiguous(p, e, val) != e;
+}
+
+template<class InputIterator, class T, class V = typename std::iterator_traits<InputIterator>::value_type>
+using exist_simd = std::integral_constant<bool,
+    is_contiguous_iterator<InputIterator>::value && is_simd_searchable<V>::value && std::is_same<V, T>::value>;
+
+} // ns _detail
+
+//! Tell whether val is in [first,last) : SIMD search over contiguous ranges of numbers
+//! (pointers, vector and string iterators, same type as val), std::find otherwise
+template<class InputIterator, class T>
+bool exist(InputIterator first, InputIterator last, const T& val) {
+    return _detail::exist_range(first, last, val, _detail::exist_simd<InputIterator, T>{});
+}
+
+//! Tell whether val is in a vector
+template<typename T, typename Alloc>
+bool exist(const std::vector<T, Alloc>& v, const T& val) {
+    return exist(v.data(), v.data() + v.size(), val);
+}
+
+//! Tell whether a character / a substring appears in a string (memchr / memmem)
+inline bool exist(const std::string& s, char c) {
+    return std::memchr(s.data(), c, s.size()) != nullptr;
+}
+
+inline bool exist(const std::string& s, const std::string& pattern) {
+#if defined(__GLIBC__)
+    return ::memmem(s.data(), s.size(), pattern.data(), pattern.size()) != nullptr;
+#else
+    return s.find(pattern) != std::string::npos;
+#endif
+}
+
+//! For each needle tell whether it is in haystack. A few needles are searched one by one,
+//! otherwise the haystack is loaded in a bitset (integers of a narrow range) or a flat_hash_set.
+template<typename T>
+std::vector<bool> exist_many(const std::vector<T>& haystack, const std::vector<T>& needles) {
+    std::vector<bool> found(needles.size(), false);
+    if (haystack.empty() || needles.empty()) {
+        return found;
+    }
+    if (needles.size() <= 8) {
+        for (size_t i = 0; i < needles.size(); i ++) { found[i] = exist(haystack, needles[i]); }
+        return found;
+    }
+    _detail::exist_many_indexed(haystack, needles, found, std::integral_constant<bool,
+                                std::is_integral<T>::value && !std::is_same<T, bool>::value>{});
+    return found;
+}
+
 //! Tell whether a given key exists in a map
 template<typename Key, typename Value>
 bool exist(const std::map<Key, Value>& m, const Key& key) {
@@ -129,41 +336,184 @@ bool exist(const std::vector<std::map<Key, Value>*>& maps, const Key& key) {
     return true;
 }
 
+//! Tell whether a given key exists in a flat_map
+template<typename Key, typename Value, typename Comp>
+bool exist(const flat_map<Key, Value, Comp>& m, const Key& key) {
+    return m.contains(key);
+}
+
+//! Tell whether a given key exists in a vector of flat_map
+template<typename Key, typename Value, typename Comp>
+bool exist(const std::vector<flat_map<Key, Value, Comp>*>& maps, const Key& key) {
+    Precondition(maps.size() > 0, "exist(): maps must not have null size!");
+    for (auto const& m : maps) {
+        if (!m->contains(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 //! Insert a block of input in output by rescaling input with output.end()
-//! Pass by value input to enable move semantics when copying and modying input
+//! Pass by value input to enable move semantics : input is rescaled in place then its
+//! elements are moved at the end of output with an end hint (amortized O(1) per node)
 template<typename Key, typename Value>
 void insert_with_rescale(std::map<Key, Value>& output, std::map<Key, Value> input) {
-    auto tmp_input = input; // should use move semantics &&
+    if (input.empty()) {
+        return;
+    }
     // If map is empty we don't have to do the following
     if (output.size() > 0) {
-        Precondition(input.begin()->first > output.begin()->first, "Insertion should be done post date to last output element!");
-        // if (input.begin()->first <= output.begin()->first) {
-        //     LOGERROR << "insert_with_rescale(): " << input.begin()->first << "<=" << output.begin()->first << '\n';
-        // }
+        Precondition(input.begin()->first > output.rbegin()->first, "Insertion should be done post date to last output element!");
         Value factor = output.rbegin()->second / input.begin()->second;
-        std::for_each(tmp_input.begin(), tmp_input.end(), [=](std::pair<const Key, Value>& p) { p.second *= factor; });
+        for (auto& p : input) { p.second *= factor; }
+    }
+    if (output.empty()) {
+        output.swap(input);
+        return;
+    }
+    for (auto& p : input) {
+        output.emplace_hint(output.end(), p.first, std::move(p.second));
+    }
+}
+
+//! Same for flat_map : input is rescaled in place and moved at the end of output (no node, no copy
+//! when input is passed as an rvalue). Input keys must all be greater than the last output key.
+template<typename Key, typename Value, typename Comp>
+void insert_with_rescale(flat_map<Key, Value, Comp>& output, flat_map<Key, Value, Comp> input) {
+    if (input.empty()) {
+        return;
+    }
+    if (output.size() > 0) {
+        Precondition(output.key_comp()(output.back_key(), input.front_key()), "Insertion should be done post date to last output element!");
+        Value factor = output.values().back() / input.values().front();
+        for (auto& v : input.values()) { v *= factor; }
     }
-    output.insert(tmp_input.begin(), tmp_input.end());
+    output.append(std::move(input));
 }
 
 
 
-//! Keep the intersection (with same keys) between several maps on (begin,end) range keys
-//! Keys must be ++ pre incrementable and have a < operator defined
+namespace _detail {
+
+//! k-way merge over the sorted ranges [first[m], last[m]) of every map : all the iterators
+//! move forward once, the largest current key is the candidate and every map erases its
+//! keys below it. O(total size), absent keys are never enumerated.
+template<typename Map>
+void intersect_map_ranges(const std::vector<Map*>& maps,
+                          std::vector<typename Map::iterator> first,
+                          const std::vector<typename Map::iterator>& last) {
+    auto comp = maps[0]->key_comp();
+    auto n = maps.size();
+    for (;;) {
+        auto target = first[0];
+        bool exhausted = false;
+        for (size_t m = 0; m < n; m ++) {
+            if (first[m] == last[m]) { exhausted = true; break; }
+            if (comp(target->first, first[m]->first)) { target = first[m]; }
+        }
+        if (exhausted) { break; }
+        auto const& key = target->first;
+        bool everywhere = true;
+        for (size_t m = 0; m < n; m ++) {
+            while (first[m] != last[m] && comp(first[m]->first, key)) { first[m] = maps[m]->erase(first[m]); }
+            if (first[m] == last[m] || comp(key, first[m]->first)) { everywhere = false; }
+        }
+        if (everywhere) {
+            for (size_t m = 0; m < n; m ++) { ++ first[m]; }
+        }
+    }
+    // one map ran out : what remains in the others can not be common
+    for (size_t m = 0; m < n; m ++) { maps[m]->erase(first[m], last[m]); }
+}
+
+//! Same merge for flat_map over index ranges, survivors are compacted in place then the tail erased
+template<typename Map>
+void intersect_flat_ranges(const std::vector<Map*>& maps, std::vector<size_t> pos, const std::vector<size_t>& last) {
+    auto comp = maps[0]->key_comp();
+    auto n = maps.size();
+    std::vector<size_t> write(pos);
+    for (;;) {
+        const typename Map::key_type* target = nullptr;
+        bool exhausted = false;
+        for (size_t m = 0; m < n; m ++) {
+            if (pos[m] == last[m]) { exhausted = true; break; }
+            auto const& k = maps[m]->keys()[pos[m]];
+            if (!target || comp(*target, k)) { target = &k; }
+        }
+        if (exhausted) { break; }
+        auto const& key = *target;
+        bool everywhere = true;
+        for (size_t m = 0; m < n; m ++) {
+            auto const& keys = maps[m]->keys();
+            while (pos[m] < last[m] && comp(keys[pos[m]], key)) { ++ pos[m]; }
+            if (pos[m] == last[m] || comp(key, keys[pos[m]])) { everywhere = false; }
+        }
+        if (everywhere) {
+            for (size_t m = 0; m < n; m ++) {
+                auto& keys = maps[m]->mutable_keys();
+                auto& values = maps[m]->values();
+                if (write[m] != pos[m]) {
+                    keys[write[m]] = std::move(keys[pos[m]]);
+                    values[write[m]] = std::move(values[pos[m]]);
+                }
+                ++ write[m];
+                ++ pos[m];
+            }
+        }
+    }
+    for (size_t m = 0; m < n; m ++) {
+        auto it = maps[m]->begin();
+        maps[m]->erase(it + static_cast<std::ptrdiff_t>(write[m]), it + static_cast<std::ptrdiff_t>(last[m]));
+    }
+}
+
+} // ns _detail
+
+//! Keep the intersection (with same keys) between several maps on [begin,end] range keys
+//! Keys only need a < operator, the maps are walked once by a k-way merge
 //! Warning! Keys which are not in the range won't be suppressed !
 template<typename Key, typename Value>
 void maps_super_intersection(const std::vector<std::map<Key, Value>*>& maps, const Key& begin, const Key& end) {
     Precondition(maps.size() > 0, "vector of map is empty!");
-    for (auto actual_key = begin; actual_key <= end; ++ actual_key) {
-        // If these keys does not exist in at least one map then we delete these keys in every maps
-        if (!exist(maps, actual_key)) {
-            for (auto& m : maps) {
-                auto it = m->find(actual_key); // boo! redundance with exists here
-                if (it != m->end()) {
-                    m->erase(it);
-                }
-            }
+    // empty range : lower_bound(begin) would lie after upper_bound(end)
+    if (!maps[0]->key_comp()(end, begin)) {
+        std::vector<typename std::map<Key, Value>::iterator> first, last;
+        for (auto const& m : maps) {
+            first.push_back(m->lower_bound(begin));
+            last.push_back(m->upper_bound(end));
+        }
+        _detail::intersect_map_ranges(maps, std::move(first), last);
+    }
+
+    for (auto const& el : maps) {
+        Postcondition(el->size() == maps[0]->size(), "maps should have same size");
+    }
+}
+
+//! Keep the intersection (with same keys) between several maps on all their keys
+template<typename Key, typename Value>
+void maps_super_intersection(const std::vector<std::map<Key, Value>*>& maps) {
+    Precondition(maps.size() > 0, "vector of map is empty!");
+    std::vector<typename std::map<Key, Value>::iterator> first, last;
+    for (auto const& m : maps) {
+        first.push_back(m->begin());
+        last.push_back(m->end());
+    }
+    _detail::intersect_map_ranges(maps, std::move(first), last);
+}
+
+//! Keep the intersection between several flat_map on [begin,end] keys, keys outside the range are kept.
+template<typename Key, typename Value, typename Comp>
+void maps_super_intersection(const std::vector<flat_map<Key, Value, Comp>*>& maps, const Key& begin, const Key& end) {
+    Precondition(maps.size() > 0, "vector of map is empty!");
+    if (!maps[0]->key_comp()(end, begin)) {
+        std::vector<size_t> first, last;
+        for (auto const& m : maps) {
+            first.push_back(m->lower_index(begin));
+            last.push_back(m->upper_index(end));
         }
+        _detail::intersect_flat_ranges(maps, std::move(first), last);
     }
 
     for (auto const& el : maps) {
@@ -171,6 +521,17 @@ void maps_super_intersection(const std::vector<std::map<Key, Value>*>& maps, con
     }
 }
 
+//! Keep the intersection between several flat_map on all their keys
+template<typename Key, typename Value, typename Comp>
+void maps_super_intersection(const std::vector<flat_map<Key, Value, Comp>*>& maps) {
+    Precondition(maps.size() > 0, "vector of map is empty!");
+    std::vector<size_t> first(maps.size(), 0), last;
+    for (auto const& m : maps) {
+        last.push_back(m->size());
+    }
+    _detail::intersect_flat_ranges(maps, std::move(first), last);
+}
+
 //! Retrieve all keys from a std::map
 template<typename Key, typename Value>
 std::vector<Key> map_retrieve_keys(const std::map<Key, Value>& m) {
@@ -180,12 +541,18 @@ std::vector<Key> map_retrieve_keys(const std::map<Key, Value>& m) {
     return keys;
 }
 
+//! Retrieve all keys from a flat_map (a copy of its key vector)
+template<typename Key, typename Value, typename Comp>
+std::vector<Key> map_retrieve_keys(const flat_map<Key, Value, Comp>& m) {
+    return m.keys();
+}
+
 //! Return a container difference between two containers
 template<typename T>
 std::vector<T> give_difference(const std::vector<T>& u, const std::vector<T>& v) {
     std::vector<T> diff;
     using std::begin; using std::end;
-    std::set_difference(begin(u), end(u), begin(v), end(v), begin(diff));
+    std::set_difference(begin(u), end(u), begin(v), end(v), std::back_inserter(diff));
     return diff;
 }
 
@@ -206,6 +573,25 @@ bool maps_check_has_same_keys(const std::vector<std::map<Key, Value>*>& maps) {
     return true;
 }
 
+//! Verify whether keys are the same, flat_map keys are compared without being copied
+template<typename Key, typename Value, typename Comp>
+bool maps_check_has_same_keys(const std::vector<flat_map<Key, Value, Comp>*>& maps) {
+    Precondition(maps.size() > 0, "vector of map is empty!");
+    for (size_t i = 1; i < maps.size(); i ++) {
+        auto const& u = maps[i]->keys();
+        auto const& v = maps[i-1]->keys();
+        if (u == v) {
+            continue;
+        }
+        auto diff = coin::give_difference(u, v);
+        if (diff.size() > 0) {
+            LOGWARNING << "Maps are different with size " << diff.size() << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
 //! Store map values into a vector while keeping order
 template<typename Key, typename Value>
 std::vector<Value> map_values_to_vector(const std::map<Key,Value>& m) {
@@ -216,6 +602,11 @@ std::vector<Value> map_values_to_vector(const std::map<Key,Value>& m) {
     return v;
 }
 
+//! Store flat_map values into a vector while keeping order
+template<typename Key, typename Value, typename Comp>
+std::vector<Value> map_values_to_vector(const flat_map<Key, Value, Comp>& m) {
+    return m.values();
+}
 
 
 //! Simple wrapper on try/retry function with counter
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <iostream>
+
+#include "logger.hpp"
+#include "except.hpp"
+
+// Allocation tracking is opt-in : the global operator new/delete hooks are only
+// defined in the translation unit which does
+//     #define COIN_ALLOC_TRACKER_IMPLEMENTATION
+//     #include "coin/alloc_tracker.hpp"
+// (exactly one per program). Without it TrackAllocations reports zeros.
+
+namespace coin {
+
+namespace _impl_alloc {
+
+//! Per thread allocation counters, deallocations are accounted to the thread which frees
+struct AllocCounters {
+    std::size_t   allocations{0};
+    std::size_t   deallocations{0};
+    std::size_t   bytes{0};    // total bytes requested
+    std::int64_t  current{0};  // live bytes
+    std::int64_t  peak{0};     // maximum of live bytes
+};
+
+inline AllocCounters& thread_alloc_counters() {
+    static thread_local AllocCounters counters;
+    return counters;
+}
+
+inline bool& alloc_hooks_installed() {
+    static bool installed{false};
+    return installed;
+}
+
+// every block is prefixed by its size, keeping the max alignment malloc gives
+constexpr std::size_t k_alloc_header = alignof(std::max_align_t);
+
+inline void* tracked_malloc(std::size_t n) noexcept {
+    auto raw = static_cast<char*>(std::malloc(n + k_alloc_header));
+    if (!raw) { return nullptr; }
+    *reinterpret_cast<std::size_t*>(raw) = n;
+    auto& c = thread_alloc_counters();
+    ++ c.allocations;
+    c.bytes += n;
+    c.current += static_cast<std::int64_t>(n);
+    if (c.current > c.peak) { c.peak = c.current; }
+    return raw + k_alloc_header;
+}
+
+inline void* tracked_new(std::size_t n) {
+    for (;;) {
+        if (auto p = tracked_malloc(n ? n : 1)) { return p; }
+        auto handler = std::get_new_handler();
+        if (!handler) { throw std::bad_alloc{}; }
+        handler();
+    }
+}
+
+inline void tracked_free(void* p) noexcept {
+    if (!p) { return; }
+    auto raw = static_cast<char*>(p) - k_alloc_header;
+    auto& c = thread_alloc_counters();
+    ++ c.deallocations;
+    c.current -= static_cast<std::int64_t>(*reinterpret_cast<std::size_t*>(raw));
+    std::free(raw);
+}
+
+
+//! Count the allocations made by the current thread during the lifetime of the scope.
+//! Scopes nest : the peak of an inner scope is accounted to the outer ones.
+//! Usage in a benchmark :
+//!     coin::TrackAllocations<> track{"hot path"};
+//!     hot_path();
+//!     track.expect_no_allocation();
+template<LogLevel Level=coin::LogLevel::log_debug>
+class TrackAllocations {
+public:
+    explicit TrackAllocations(const std::string& lbl = "", bool report = true)
+        : label_(lbl)
+        , report_{report} {
+        auto& c = thread_alloc_counters();
+        base_allocations_   = c.allocations;
+        base_deallocations_ = c.deallocations;
+        base_bytes_         = c.bytes;
+        base_current_       = c.current;
+        saved_peak_         = c.peak;
+        c.peak              = c.current;
+    }
+
+    TrackAllocations(const TrackAllocations&)            = delete;
+    TrackAllocations& operator=(const TrackAllocations&) = delete;
+
+    ~TrackAllocations() {
+        if (report_) {
+#ifdef DISABLE_LOG
+            std::cout << "[Alloc] " << label_ << " : " << to_string() << "\n";
+#else
+            coin::_detail::Log<Level>(std::cout) << "[Alloc] " << label_ << " : " << to_string() << "\n";
+#endif
+        }
+        auto& c = thread_alloc_counters();
+        if (saved_peak_ > c.peak) { c.peak = saved_peak_; }
+    }
+
+    static bool enabled() { return alloc_hooks_installed(); }
+
+    std::size_t count()         const { return thread_alloc_counters().allocations - base_allocations_; }
+    std::size_t deallocations() const { return thread_alloc_counters().deallocations - base_deallocations_; }
+    std::size_t bytes()         const { return thread_alloc_counters().bytes - base_bytes_; }
+    //! Maximum of bytes alive at once inside the scope, on top of what was alive before
+    std::size_t peak() const {
+        auto p = thread_alloc_counters().peak - base_current_;
+        return p > 0 ? static_cast<std::size_t>(p) : 0;
+    }
+
+    //! Throw coin::fail_fast if anything was allocated since the beginning of the scope,
+    //! or if the hooks are not installed (nothing could be counted)
+    void expect_no_allocation() const {
+        if (!enabled()) {
+            throw coin::fail_fast("TrackAllocations: " + label_ + " ", "allocation hooks not installed, define COIN_ALLOC_TRACKER_IMPLEMENTATION in one translation unit");
+        }
+        if (count() != 0) {
+            throw coin::fail_fast("TrackAllocations: " + label_ + " ", "expected no allocation but got " + to_string());
+        }
+    }
+
+    std::string to_string() const {
+        if (!enabled()) { return "allocation hooks not installed"; }
+        using std::to_string;
+        return to_string(count()) + " allocs, " + to_string(deallocations()) + " frees, "
+            + to_string(bytes()) + " bytes, peak " + to_string(peak()) + " bytes";
+    }
+
+private:
+    std::string  label_;
+    bool         report_;
+    std::size_t  base_allocations_;
+    std::size_t  base_deallocations_;
+    std::size_t  base_bytes_;
+    std::int64_t base_current_;
+    std::int64_t saved_peak_;
+};
+
+} // ns _impl_alloc
+
+using _impl_alloc::AllocCounters;
+using _impl_alloc::thread_alloc_counters;
+using _impl_alloc::TrackAllocations;
+
+} // ns coin
+
+
+#ifdef COIN_ALLOC_TRACKER_IMPLEMENTATION
+
+namespace coin { namespace _impl_alloc {
+static const bool k_alloc_hooks_registered = (alloc_hooks_installed() = true);
+}} // ns coin::_impl_alloc
+
+void* operator new(std::size_t n)                                  { return coin::_impl_alloc::tracked_new(n); }
+void* operator new[](std::size_t n)                                { return coin::_impl_alloc::tracked_new(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept  { return coin::_impl_alloc::tracked_malloc(n ? n : 1); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept{ return coin::_impl_alloc::tracked_malloc(n ? n : 1); }
+void  operator delete(void* p) noexcept                            { coin::_impl_alloc::tracked_free(p); }
+void  operator delete[](void* p) noexcept                          { coin::_impl_alloc::tracked_free(p); }
+void  operator delete(void* p, std::size_t) noexcept               { coin::_impl_alloc::tracked_free(p); }
+void  operator delete[](void* p, std::size_t) noexcept             { coin::_impl_alloc::tracked_free(p); }
+void  operator delete(void* p, const std::nothrow_t&) noexcept     { coin::_impl_alloc::tracked_free(p); }
+void  operator delete[](void* p, const std::nothrow_t&) noexcept   { coin::_impl_alloc::tracked_free(p); }
+
+#endif // COIN_ALLOC_TRACKER_IMPLEMENTATION
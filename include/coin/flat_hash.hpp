@@ -0,0 +1,437 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COIN_FLAT_HASH_SSE2 1
+#endif
+
+#include "except.hpp"
+
+namespace coin {
+
+namespace _impl_flat_hash {
+
+// control byte of a slot : empty / deleted (sign bit set) or the 7 low bits of the hash
+enum : std::int8_t { k_empty = -128, k_deleted = -2 };
+
+constexpr std::size_t k_group = 16;
+
+//! Bit i set when byte i of the group matches
+using group_mask = std::uint32_t;
+
+inline int first_bit(group_mask m) { return __builtin_ctz(m); }
+
+#ifdef COIN_FLAT_HASH_SSE2
+inline group_mask group_match(const std::int8_t* ctrl, std::int8_t h2) {
+    auto g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return static_cast<group_mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(h2))));
+}
+inline group_mask group_empty(const std::int8_t* ctrl) {
+    return group_match(ctrl, k_empty);
+}
+inline group_mask group_empty_or_deleted(const std::int8_t* ctrl) {
+    auto g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return static_cast<group_mask>(_mm_movemask_epi8(g));
+}
+#else
+inline group_mask group_match(const std::int8_t* ctrl, std::int8_t h2) {
+    group_mask m = 0;
+    for (std::size_t i = 0; i < k_group; i ++) { m |= group_mask(ctrl[i] == h2) << i; }
+    return m;
+}
+inline group_mask group_empty(const std::int8_t* ctrl) {
+    return group_match(ctrl, k_empty);
+}
+inline group_mask group_empty_or_deleted(const std::int8_t* ctrl) {
+    group_mask m = 0;
+    for (std::size_t i = 0; i < k_group; i ++) { m |= group_mask(ctrl[i] < 0) << i; }
+    return m;
+}
+#endif
+
+//! std::hash is the identity for integers : spread the bits before splitting in H1/H2
+inline std::size_t mix_hash(std::size_t h) {
+    std::uint64_t x = h;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return static_cast<std::size_t>(x);
+}
+
+struct identity_key {
+    template<typename T> const T& operator()(const T& v) const { return v; }
+};
+
+struct pair_first {
+    template<typename P> const typename P::first_type& operator()(const P& p) const { return p.first; }
+};
+
+
+//! Open addressing table in the Swiss table layout : one control byte per slot, slots
+//! are probed a group of 16 control bytes at a time (one SSE2 compare per group), the
+//! group sequence being triangular over power of two group count. Max load is 7/8.
+//! Value is the stored type, KeyOf extracts the key from it (set and map share it).
+template<typename Value, typename KeyOf, typename Hash, typename KeyEqual>
+class raw_flat_table {
+public:
+    using value_type = Value;
+    using size_type  = std::size_t;
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Value;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = Value*;
+        using reference         = Value&;
+
+        iterator() = default;
+        reference operator*()  const { return table_->slot(index_); }
+        pointer   operator->() const { return &table_->slot(index_); }
+        iterator& operator++() { ++ index_; skip(); return *this; }
+        iterator  operator++(int) { auto it = *this; ++ *this; return it; }
+        bool operator==(const iterator& o) const { return index_ == o.index_; }
+        bool operator!=(const iterator& o) const { return index_ != o.index_; }
+
+    private:
+        friend class raw_flat_table;
+        iterator(const raw_flat_table* t, size_type i) : table_{t}, index_{i} { skip(); }
+        void skip() { while (index_ < table_->capacity_ && table_->ctrl_[index_] < 0) { ++ index_; } }
+
+        const raw_flat_table* table_{nullptr};
+        size_type             index_{0};
+    };
+    using const_iterator = iterator;
+
+    explicit raw_flat_table(size_type n = 0, const Hash& hash = Hash{}, const KeyEqual& eq = KeyEqual{})
+        : hash_(hash)
+        , eq_(eq) {
+        if (n) { reserve(n); }
+    }
+
+    raw_flat_table(const raw_flat_table& o)
+        : hash_(o.hash_)
+        , eq_(o.eq_) {
+        reserve(o.size_);
+        for (auto const& v : o) { insert_unique(hash_of(KeyOf{}(v)), v); }
+    }
+
+    raw_flat_table(raw_flat_table&& o) noexcept
+        : hash_(std::move(o.hash_))
+        , eq_(std::move(o.eq_)) {
+        steal(o);
+    }
+
+    raw_flat_table& operator=(raw_flat_table o) noexcept {
+        destroy();
+        hash_ = std::move(o.hash_);
+        eq_   = std::move(o.eq_);
+        steal(o);
+        return *this;
+    }
+
+    ~raw_flat_table() { destroy(); }
+
+    iterator begin() const { return iterator{this, 0}; }
+    iterator end()   const { return iterator{this, capacity_}; }
+
+    size_type size()     const { return size_; }
+    bool      empty()    const { return size_ == 0; }
+    size_type capacity() const { return capacity_; }
+
+    void clear() {
+        destroy_slots();
+        if (capacity_) { std::memset(ctrl_.get(), k_empty, capacity_); }
+        size_ = 0;
+        growth_left_ = max_load(capacity_);
+    }
+
+    //! Make room for n elements without rehash
+    void reserve(size_type n) {
+        if (n > max_load(capacity_) || (capacity_ && n > growth_left_ + size_)) {
+            size_type cap = k_group;
+            while (max_load(cap) < n) { cap <<= 1; }
+            rehash(cap > capacity_ ? cap : capacity_);
+        }
+    }
+
+    template<typename K>
+    iterator find(const K& key) const {
+        auto h = hash_of(key);
+        auto i = find_hashed(h, [&](const Value& v) { return eq_(KeyOf{}(v), key); });
+        return iterator{this, i};
+    }
+
+    template<typename K>
+    bool contains(const K& key) const { return find(key) != end(); }
+
+    //! Insert value if its key is absent, return the element and whether it was inserted
+    std::pair<iterator, bool> insert(const Value& v) { return emplace_value(v); }
+    std::pair<iterator, bool> insert(Value&& v)      { return emplace_value(std::move(v)); }
+
+    template<typename K>
+    size_type erase(const K& key) {
+        auto it = find(key);
+        if (it == end()) { return 0; }
+        erase_at(it.index_);
+        return 1;
+    }
+
+    void erase(iterator it) { erase_at(it.index_); }
+
+    //! Low level lookup with a precomputed hash (see mix_hash) and a custom predicate on the stored values
+    template<typename Pred>
+    size_type find_hashed(std::size_t h, Pred&& pred) const {
+        if (!capacity_) { return capacity_; }
+        auto h2 = static_cast<std::int8_t>(h & 0x7f);
+        auto groups_mask = capacity_ / k_group - 1;
+        auto g = (h >> 7) & groups_mask;
+        for (size_type step = 1;; step ++) {
+            auto ctrl = ctrl_.get() + g * k_group;
+            for (auto m = group_match(ctrl, h2); m; m &= m - 1) {
+                auto i = g * k_group + first_bit(m);
+                if (pred(slot(i))) { return i; }
+            }
+            if (group_empty(ctrl)) { return capacity_; }
+            g = (g + step) & groups_mask;
+        }
+    }
+
+    //! Low level insertion : look for the value matching pred, or call make(void* slot)
+    //! to construct it in place. Return the slot index and whether make was called.
+    template<typename Pred, typename Make>
+    std::pair<size_type, bool> emplace_hashed(std::size_t h, Pred&& pred, Make&& make) {
+        auto i = find_hashed(h, pred);
+        if (i != capacity_) { return {i, false}; }
+        if (growth_left_ == 0) { grow(); }
+        i = find_free(h);
+        make(static_cast<void*>(&slots_[i]));
+        set_ctrl(i, h);
+        return {i, true};
+    }
+
+    //! Low level insertion of a value whose key is known to be absent (no lookup)
+    template<typename V>
+    size_type insert_unique_hashed(std::size_t h, V&& v) {
+        if (growth_left_ == 0) { grow(); }
+        return insert_unique(h, std::forward<V>(v));
+    }
+
+    Value& slot(size_type i) const { return *reinterpret_cast<Value*>(&slots_[i]); }
+    iterator iterator_at(size_type i) const { return iterator{this, i}; }
+
+    template<typename K>
+    std::size_t hash_of(const K& key) const { return mix_hash(hash_(key)); }
+
+    const Hash&     hash_function() const { return hash_; }
+    const KeyEqual& key_eq()        const { return eq_; }
+
+private:
+    using Slot = std::aligned_storage_t<sizeof(Value), alignof(Value)>;
+
+    static size_type max_load(size_type cap) { return cap - cap / 8; }
+
+    template<typename V>
+    std::pair<iterator, bool> emplace_value(V&& v) {
+        auto const& key = KeyOf{}(v);
+        auto r = emplace_hashed(hash_of(key), [&](const Value& s) { return eq_(KeyOf{}(s), key); },
+                                [&](void* p) { new (p) Value(std::forward<V>(v)); });
+        return {iterator{this, r.first}, r.second};
+    }
+
+    // key known to be absent
+    template<typename V>
+    size_type insert_unique(std::size_t h, V&& v) {
+        auto i = find_free(h);
+        new (&slots_[i]) Value(std::forward<V>(v));
+        set_ctrl(i, h);
+        return i;
+    }
+
+    size_type find_free(std::size_t h) const {
+        auto groups_mask = capacity_ / k_group - 1;
+        auto g = (h >> 7) & groups_mask;
+        for (size_type step = 1;; step ++) {
+            if (auto m = group_empty_or_deleted(ctrl_.get() + g * k_group)) {
+                return g * k_group + first_bit(m);
+            }
+            g = (g + step) & groups_mask;
+        }
+    }
+
+    void set_ctrl(size_type i, std::size_t h) {
+        if (ctrl_[i] == k_empty) { -- growth_left_; }
+        ctrl_[i] = static_cast<std::int8_t>(h & 0x7f);
+        ++ size_;
+    }
+
+    void erase_at(size_type i) {
+        slot(i).~Value();
+        -- size_;
+        // a slot whose group still has an empty byte can go back to empty : no probe sequence went through it
+        auto g = i / k_group * k_group;
+        if (group_empty(ctrl_.get() + g)) {
+            ctrl_[i] = k_empty;
+            ++ growth_left_;
+        }
+        else {
+            ctrl_[i] = k_deleted;
+        }
+    }
+
+    // double when really full, rehash in place size when mostly tombstones
+    void grow() {
+        rehash(size_ * 2 >= max_load(capacity_) ? (capacity_ ? capacity_ * 2 : k_group) : capacity_);
+    }
+
+    void rehash(size_type cap) {
+        std::unique_ptr<std::int8_t[]> old_ctrl(std::move(ctrl_));
+        std::unique_ptr<Slot[]>        old_slots(std::move(slots_));
+        auto old_cap = capacity_;
+
+        ctrl_.reset(new std::int8_t[cap]);
+        slots_.reset(new Slot[cap]);
+        std::memset(ctrl_.get(), k_empty, cap);
+        capacity_    = cap;
+        size_        = 0;
+        growth_left_ = max_load(cap);
+        for (size_type i = 0; i < old_cap; i ++) {
+            if (old_ctrl[i] >= 0) {
+                auto& v = *reinterpret_cast<Value*>(&old_slots[i]);
+                insert_unique(hash_of(KeyOf{}(v)), std::move(v));
+                v.~Value();
+            }
+        }
+    }
+
+    void destroy_slots() {
+        for (size_type i = 0; i < capacity_; i ++) {
+            if (ctrl_[i] >= 0) { slot(i).~Value(); }
+        }
+    }
+
+    void destroy() {
+        destroy_slots();
+        ctrl_.reset();
+        slots_.reset();
+        capacity_ = size_ = growth_left_ = 0;
+    }
+
+    void steal(raw_flat_table& o) {
+        ctrl_        = std::move(o.ctrl_);
+        slots_       = std::move(o.slots_);
+        capacity_    = o.capacity_;
+        size_        = o.size_;
+        growth_left_ = o.growth_left_;
+        o.capacity_ = o.size_ = o.growth_left_ = 0;
+    }
+
+    std::unique_ptr<std::int8_t[]> ctrl_;
+    std::unique_ptr<Slot[]>        slots_;
+    size_type                      capacity_{0};
+    size_type                      size_{0};
+    size_type                      growth_left_{0};
+    Hash                           hash_;
+    KeyEqual                       eq_;
+};
+
+
+//! Open addressing hash set (Swiss table layout with SSE2 group probing)
+template<typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class flat_hash_set : public raw_flat_table<Key, identity_key, Hash, KeyEqual> {
+    using base = raw_flat_table<Key, identity_key, Hash, KeyEqual>;
+public:
+    using key_type = Key;
+    using base::base;
+
+    template<typename InputIt>
+    flat_hash_set(InputIt first, InputIt last) {
+        for (; first != last; ++ first) { this->insert(*first); }
+    }
+
+    flat_hash_set(std::initializer_list<Key> init) : flat_hash_set(init.begin(), init.end()) {}
+
+    template<typename... Args>
+    std::pair<typename base::iterator, bool> emplace(Args&&... args) { return this->insert(Key(std::forward<Args>(args)...)); }
+
+    template<typename K>
+    std::size_t count(const K& key) const { return this->contains(key) ? 1 : 0; }
+};
+
+
+//! Open addressing hash map (Swiss table layout with SSE2 group probing), elements are
+//! std::pair<const Key, T> stored inline : no node allocation, unlike std::unordered_map.
+//! Rehash and erase move elements, iterators and references do not survive them.
+template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class flat_hash_map : public raw_flat_table<std::pair<const Key, T>, pair_first, Hash, KeyEqual> {
+    using base = raw_flat_table<std::pair<const Key, T>, pair_first, Hash, KeyEqual>;
+public:
+    using key_type    = Key;
+    using mapped_type = T;
+    using typename base::value_type;
+    using typename base::iterator;
+    using base::base;
+
+    template<typename InputIt>
+    flat_hash_map(InputIt first, InputIt last) {
+        for (; first != last; ++ first) { this->insert(*first); }
+    }
+
+    flat_hash_map(std::initializer_list<value_type> init) : flat_hash_map(init.begin(), init.end()) {}
+
+    //! Construct the mapped value from args if key is absent, nothing is built otherwise
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+        return try_emplace_hashed(this->hash_of(key), key, std::forward<Args>(args)...);
+    }
+
+    //! Same with a hash computed beforehand by hash_of (hashes of a batch computed in parallel)
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace_hashed(std::size_t h, const Key& key, Args&&... args) {
+        auto r = this->emplace_hashed(h, [&](const value_type& v) { return this->key_eq()(v.first, key); }, [&](void* p) {
+            new (p) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        });
+        return {this->iterator_at(r.first), r.second};
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) { return this->insert(value_type(std::forward<Args>(args)...)); }
+
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& m) {
+        auto r = try_emplace(key, std::forward<M>(m));
+        if (!r.second) { r.first->second = std::forward<M>(m); }
+        return r;
+    }
+
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+    T& at(const Key& key) {
+        auto it = this->find(key);
+        Precondition(it != this->end(), "flat_hash_map::at: key not found!");
+        return it->second;
+    }
+    const T& at(const Key& key) const { return const_cast<flat_hash_map&>(*this).at(key); }
+
+    template<typename K>
+    std::size_t count(const K& key) const { return this->contains(key) ? 1 : 0; }
+};
+
+} // ns _impl_flat_hash
+
+using _impl_flat_hash::flat_hash_set;
+using _impl_flat_hash::flat_hash_map;
+
+} // ns coin
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "except.hpp"
+
+namespace coin {
+
+namespace _impl_flat_map {
+
+//! Ordered map stored as two sorted vectors (keys and values apart) : lookups are binary
+//! searches over contiguous keys, iteration is a linear scan and appending keys greater
+//! than the last one is amortized O(1). Insertion in the middle is O(n).
+//! Iterators are random access proxies dereferencing to std::pair<const Key&, Value&>,
+//! they are invalidated by any insertion or erasure.
+template<typename Key, typename Value, typename Compare = std::less<Key>>
+class flat_map {
+public:
+    using key_type    = Key;
+    using mapped_type = Value;
+    using value_type  = std::pair<Key, Value>;
+    using size_type   = std::size_t;
+    using key_compare = Compare;
+
+    template<bool Const>
+    class basic_iterator {
+        using map_ptr = std::conditional_t<Const, const flat_map*, flat_map*>;
+        using mapped  = std::conditional_t<Const, const Value, Value>;
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = flat_map::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = std::pair<const Key&, mapped&>;
+
+        struct pointer {
+            reference ref;
+            const reference* operator->() const { return &ref; }
+        };
+
+        basic_iterator() = default;
+        basic_iterator(map_ptr m, size_type i) : map_{m}, index_{i} {}
+        template<bool C, typename = std::enable_if_t<Const && !C>>
+        basic_iterator(const basic_iterator<C>& o) : map_{o.map_}, index_{o.index_} {}
+
+        reference operator*()  const { return {map_->keys_[index_], map_->values_[index_]}; }
+        pointer   operator->() const { return pointer{**this}; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        const Key& key()   const { return map_->keys_[index_]; }
+        mapped&    value() const { return map_->values_[index_]; }
+        size_type  index() const { return index_; }
+
+        basic_iterator& operator++()    { ++ index_; return *this; }
+        basic_iterator& operator--()    { -- index_; return *this; }
+        basic_iterator  operator++(int) { auto it = *this; ++ index_; return it; }
+        basic_iterator  operator--(int) { auto it = *this; -- index_; return it; }
+        basic_iterator& operator+=(difference_type n) { index_ += n; return *this; }
+        basic_iterator& operator-=(difference_type n) { index_ -= n; return *this; }
+        basic_iterator  operator+(difference_type n) const { return {map_, index_ + n}; }
+        basic_iterator  operator-(difference_type n) const { return {map_, index_ - n}; }
+        friend basic_iterator operator+(difference_type n, const basic_iterator& it) { return it + n; }
+        difference_type operator-(const basic_iterator& o) const {
+            return static_cast<difference_type>(index_) - static_cast<difference_type>(o.index_);
+        }
+
+        bool operator==(const basic_iterator& o) const { return index_ == o.index_; }
+        bool operator!=(const basic_iterator& o) const { return index_ != o.index_; }
+        bool operator< (const basic_iterator& o) const { return index_ <  o.index_; }
+        bool operator> (const basic_iterator& o) const { return index_ >  o.index_; }
+        bool operator<=(const basic_iterator& o) const { return index_ <= o.index_; }
+        bool operator>=(const basic_iterator& o) const { return index_ >= o.index_; }
+
+    private:
+        template<bool> friend class basic_iterator;
+        map_ptr   map_{nullptr};
+        size_type index_{0};
+    };
+
+    using iterator               = basic_iterator<false>;
+    using const_iterator         = basic_iterator<true>;
+    using reverse_iterator       = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    flat_map() = default;
+
+    explicit flat_map(const Compare& comp) : comp_(comp) {}
+
+    //! From std::map : already sorted, no comparison done
+    template<typename Alloc>
+    explicit flat_map(const std::map<Key, Value, Compare, Alloc>& m) : comp_(m.key_comp()) {
+        reserve(m.size());
+        for (auto const& p : m) { keys_.push_back(p.first); values_.push_back(p.second); }
+    }
+
+    template<typename InputIt>
+    flat_map(InputIt first, InputIt last, const Compare& comp = Compare{}) : comp_(comp) {
+        insert(first, last);
+    }
+
+    flat_map(std::initializer_list<value_type> init, const Compare& comp = Compare{})
+        : flat_map(init.begin(), init.end(), comp) {}
+
+    //! Adopt parallel key/value vectors, keys must be sorted and unique
+    flat_map(std::vector<Key> keys, std::vector<Value> values, const Compare& comp = Compare{})
+        : keys_(std::move(keys))
+        , values_(std::move(values))
+        , comp_(comp) {
+        Precondition(keys_.size() == values_.size(), "flat_map: keys and values must have the same size!");
+        Precondition(is_strictly_sorted(keys_.begin(), keys_.end()), "flat_map: keys must be sorted and unique!");
+    }
+
+    std::map<Key, Value, Compare> to_map() const {
+        std::map<Key, Value, Compare> m(comp_);
+        for (size_type i = 0; i < size(); i ++) { m.emplace_hint(m.end(), keys_[i], values_[i]); }
+        return m;
+    }
+
+    iterator       begin()        { return {this, 0}; }
+    iterator       end()          { return {this, size()}; }
+    const_iterator begin()  const { return {this, 0}; }
+    const_iterator end()    const { return {this, size()}; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend()   const { return end(); }
+    reverse_iterator       rbegin()       { return reverse_iterator{end()}; }
+    reverse_iterator       rend()         { return reverse_iterator{begin()}; }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator{end()}; }
+    const_reverse_iterator rend()   const { return const_reverse_iterator{begin()}; }
+
+    size_type size()     const { return keys_.size(); }
+    bool      empty()    const { return keys_.empty(); }
+    size_type capacity() const { return keys_.capacity(); }
+    void reserve(size_type n) { keys_.reserve(n); values_.reserve(n); }
+    void clear() { keys_.clear(); values_.clear(); }
+    void shrink_to_fit() { keys_.shrink_to_fit(); values_.shrink_to_fit(); }
+
+    //! Contiguous storage, keys are read only to keep them sorted
+    const std::vector<Key>&   keys()   const { return keys_; }
+    const std::vector<Value>& values() const { return values_; }
+    std::vector<Value>&       values()       { return values_; }
+
+    const Key& front_key() const { return keys_.front(); }
+    const Key& back_key()  const { return keys_.back(); }
+    key_compare key_comp() const { return comp_; }
+
+    iterator       lower_bound(const Key& k)       { return {this, lower_index(k)}; }
+    const_iterator lower_bound(const Key& k) const { return {this, lower_index(k)}; }
+    iterator       upper_bound(const Key& k)       { return {this, upper_index(k)}; }
+    const_iterator upper_bound(const Key& k) const { return {this, upper_index(k)}; }
+
+    iterator       find(const Key& k)       { return {this, find_index(k)}; }
+    const_iterator find(const Key& k) const { return {this, find_index(k)}; }
+    size_type count(const Key& k)    const { return find_index(k) != size() ? 1 : 0; }
+    bool      contains(const Key& k) const { return find_index(k) != size(); }
+
+    Value& at(const Key& k) {
+        auto i = find_index(k);
+        if (i == size()) { throw std::out_of_range("flat_map::at: key not found"); }
+        return values_[i];
+    }
+    const Value& at(const Key& k) const { return const_cast<flat_map&>(*this).at(k); }
+
+    Value& operator[](const Key& k) { return try_emplace(k).first.value(); }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& k, Args&&... args) {
+        if (empty() || comp_(keys_.back(), k)) { // append fast path
+            keys_.push_back(k);
+            values_.emplace_back(std::forward<Args>(args)...);
+            return {iterator{this, size() - 1}, true};
+        }
+        auto i = lower_index(k);
+        if (i != size() && !comp_(k, keys_[i])) { return {iterator{this, i}, false}; }
+        keys_.insert(keys_.begin() + i, k);
+        values_.insert(values_.begin() + i, Value(std::forward<Args>(args)...));
+        return {iterator{this, i}, true};
+    }
+
+    template<typename V>
+    std::pair<iterator, bool> emplace(const Key& k, V&& v) { return try_emplace(k, std::forward<V>(v)); }
+
+    std::pair<iterator, bool> insert(const value_type& p) { return try_emplace(p.first, p.second); }
+    std::pair<iterator, bool> insert(value_type&& p)      { return try_emplace(p.first, std::move(p.second)); }
+
+    template<typename V>
+    std::pair<iterator, bool> insert_or_assign(const Key& k, V&& v) {
+        auto r = try_emplace(k, std::forward<V>(v));
+        if (!r.second) { r.first.value() = std::forward<V>(v); }
+        return r;
+    }
+
+    //! Bulk insertion : the new elements are sorted apart then merged in one pass.
+    //! As for std::map, keys already present (or repeated in the range) keep their first value.
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        std::vector<value_type> items(first, last);
+        std::stable_sort(items.begin(), items.end(),
+                         [this](const value_type& a, const value_type& b) { return comp_(a.first, b.first); });
+        if (items.empty()) { return; }
+        if (empty() || comp_(keys_.back(), items.front().first)) {
+            reserve(size() + items.size());
+            for (auto& p : items) {
+                if (keys_.size() != 0 && !comp_(keys_.back(), p.first)) { continue; }
+                keys_.push_back(std::move(p.first));
+                values_.push_back(std::move(p.second));
+            }
+            return;
+        }
+        std::vector<Key>   keys;
+        std::vector<Value> values;
+        keys.reserve(size() + items.size());
+        values.reserve(size() + items.size());
+        size_type i = 0;
+        auto it = items.begin();
+        auto push = [&](Key&& k, Value&& v) {
+            if (keys.size() != 0 && !comp_(keys.back(), k)) { return; }
+            keys.push_back(std::move(k));
+            values.push_back(std::move(v));
+        };
+        while (i < size() || it != items.end()) {
+            if (it == items.end() || (i < size() && !comp_(it->first, keys_[i]))) {
+                push(std::move(keys_[i]), std::move(values_[i]));
+                ++ i;
+            }
+            else {
+                push(std::move(it->first), std::move(it->second));
+                ++ it;
+            }
+        }
+        keys_.swap(keys);
+        values_.swap(values);
+    }
+
+    void insert(std::initializer_list<value_type> init) { insert(init.begin(), init.end()); }
+
+    //! Append fast path : k must be greater than every key already in the map
+    template<typename V>
+    void append(const Key& k, V&& v) {
+        Precondition(empty() || comp_(keys_.back(), k), "flat_map::append: key must be greater than the last key!");
+        keys_.push_back(k);
+        values_.push_back(std::forward<V>(v));
+    }
+
+    //! Append a sorted range of pairs whose keys are all greater than the last key
+    template<typename InputIt>
+    void append(InputIt first, InputIt last) {
+        for (; first != last; ++ first) { append((*first).first, (*first).second); }
+    }
+
+    //! Append (moving) every element of another flat_map whose keys all come after ours
+    void append(flat_map&& other) {
+        Precondition(other.empty() || empty() || comp_(keys_.back(), other.keys_.front()),
+                     "flat_map::append: keys must be greater than the last key!");
+        if (empty()) { keys_.swap(other.keys_); values_.swap(other.values_); return; }
+        keys_.insert(keys_.end(), std::make_move_iterator(other.keys_.begin()), std::make_move_iterator(other.keys_.end()));
+        values_.insert(values_.end(), std::make_move_iterator(other.values_.begin()), std::make_move_iterator(other.values_.end()));
+        other.clear();
+    }
+
+    size_type erase(const Key& k) {
+        auto i = find_index(k);
+        if (i == size()) { return 0; }
+        erase_range(i, i + 1);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        erase_range(first.index(), last.index());
+        return {this, first.index()};
+    }
+
+    //! Remove every element for which pred(key, value) is true, in one pass
+    template<typename Pred>
+    size_type erase_if(Pred pred) {
+        size_type w = 0;
+        for (size_type i = 0; i < size(); i ++) {
+            if (pred(static_cast<const Key&>(keys_[i]), static_cast<const Value&>(values_[i]))) { continue; }
+            if (w != i) {
+                keys_[w]   = std::move(keys_[i]);
+                values_[w] = std::move(values_[i]);
+            }
+            ++ w;
+        }
+        auto removed = size() - w;
+        erase_range(w, size());
+        return removed;
+    }
+
+    void swap(flat_map& o) {
+        keys_.swap(o.keys_);
+        values_.swap(o.values_);
+        std::swap(comp_, o.comp_);
+    }
+
+    friend bool operator==(const flat_map& a, const flat_map& b) { return a.keys_ == b.keys_ && a.values_ == b.values_; }
+    friend bool operator!=(const flat_map& a, const flat_map& b) { return !(a == b); }
+
+    // Low level access used by the algorithm.hpp helpers, they keep keys sorted
+    std::vector<Key>& mutable_keys() { return keys_; }
+
+    size_type lower_index(const Key& k) const {
+        return std::lower_bound(keys_.begin(), keys_.end(), k, comp_) - keys_.begin();
+    }
+    size_type upper_index(const Key& k) const {
+        return std::upper_bound(keys_.begin(), keys_.end(), k, comp_) - keys_.begin();
+    }
+    size_type find_index(const Key& k) const {
+        auto i = lower_index(k);
+        return (i != size() && !comp_(k, keys_[i])) ? i : size();
+    }
+
+private:
+    template<typename It>
+    bool is_strictly_sorted(It first, It last) const {
+        return std::adjacent_find(first, last, [this](const Key& a, const Key& b) { return !comp_(a, b); }) == last;
+    }
+
+    void erase_range(size_type b, size_type e) {
+        keys_.erase(keys_.begin() + b, keys_.begin() + e);
+        values_.erase(values_.begin() + b, values_.begin() + e);
+    }
+
+    std::vector<Key>   keys_;
+    std::vector<Value> values_;
+    Compare            comp_;
+};
+
+} // ns _impl_flat_map
+
+using _impl_flat_map::flat_map;
+
+} // ns coin
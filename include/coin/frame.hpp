@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "date.hpp"
+#include "except.hpp"
+
+namespace coin {
+
+namespace _impl_frame {
+
+//! Non owning view over a contiguous column (T const for a read only view).
+//! Element wise operations are plain indexed loops the compiler vectorizes.
+template<typename T>
+class ColumnView {
+public:
+    using value_type = std::remove_const_t<T>;
+
+    ColumnView() = default;
+    ColumnView(T* data, std::size_t size) : data_{data}, size_{size} {}
+    template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+    ColumnView(const ColumnView<U>& o) : data_{o.data()}, size_{o.size()} {}
+
+    T*          data()  const { return data_; }
+    std::size_t size()  const { return size_; }
+    bool        empty() const { return size_ == 0; }
+    T*          begin() const { return data_; }
+    T*          end()   const { return data_ + size_; }
+    T&          operator[](std::size_t i) const { return data_[i]; }
+
+    //! Rows [b,e) without copy
+    ColumnView subview(std::size_t b, std::size_t e) const {
+        Precondition(b <= e && e <= size_, "ColumnView::subview: range out of bounds!");
+        return ColumnView{data_ + b, e - b};
+    }
+
+    std::vector<value_type> to_vector() const { return std::vector<value_type>(begin(), end()); }
+
+    value_type sum() const {
+        value_type s{};
+        for (std::size_t i = 0; i < size_; i ++) { s += data_[i]; }
+        return s;
+    }
+    value_type mean() const { return size_ ? sum() / static_cast<value_type>(size_) : value_type{}; }
+    value_type dot(ColumnView<const value_type> o) const {
+        check_size(o);
+        value_type s{};
+        for (std::size_t i = 0; i < size_; i ++) { s += data_[i] * o[i]; }
+        return s;
+    }
+
+    //! out[i] = op(data[i])
+    template<typename Op>
+    void apply(Op op) const {
+        for (std::size_t i = 0; i < size_; i ++) { data_[i] = op(data_[i]); }
+    }
+
+    const ColumnView& operator+=(value_type k) const { apply([k](value_type v) { return v + k; }); return *this; }
+    const ColumnView& operator-=(value_type k) const { apply([k](value_type v) { return v - k; }); return *this; }
+    const ColumnView& operator*=(value_type k) const { apply([k](value_type v) { return v * k; }); return *this; }
+    const ColumnView& operator/=(value_type k) const { apply([k](value_type v) { return v / k; }); return *this; }
+
+    const ColumnView& operator+=(ColumnView<const value_type> o) const { zip(o, [](value_type a, value_type b) { return a + b; }); return *this; }
+    const ColumnView& operator-=(ColumnView<const value_type> o) const { zip(o, [](value_type a, value_type b) { return a - b; }); return *this; }
+    const ColumnView& operator*=(ColumnView<const value_type> o) const { zip(o, [](value_type a, value_type b) { return a * b; }); return *this; }
+    const ColumnView& operator/=(ColumnView<const value_type> o) const { zip(o, [](value_type a, value_type b) { return a / b; }); return *this; }
+
+    //! data[i] = op(data[i], o[i]), in increasing i when the two views overlap (col += col)
+    template<typename Op>
+    void zip(ColumnView<const value_type> o, Op op) const {
+        check_size(o);
+        std::less<const value_type*> before;
+        if (!before(data_, o.data() + size_) || !before(o.data(), data_ + size_)) {
+            auto* __restrict dst = data_;
+            auto* __restrict src = o.data();
+            for (std::size_t i = 0; i < size_; i ++) { dst[i] = op(dst[i], src[i]); }
+            return;
+        }
+        for (std::size_t i = 0; i < size_; i ++) { data_[i] = op(data_[i], o[i]); }
+    }
+
+private:
+    void check_size(ColumnView<const value_type> o) const {
+        Precondition(o.size() == size_, "ColumnView: columns must have the same size!");
+    }
+
+    T*          data_{nullptr};
+    std::size_t size_{0};
+};
+
+
+enum class FrameJoin { inner, outer };
+
+//! Several series sharing one sorted date index, stored by columns : the index is one
+//! int32 per row (days since epoch) and every series is a contiguous vector of T, instead
+//! of one std::map node (key duplicated, ~48 bytes) per point and per series.
+//! Missing values (outer join) are NaN.
+template<typename T = double>
+class BasicFrame {
+public:
+    using value_type = T;
+    using day_type   = std::int32_t;
+    using map_type   = std::map<date::day_point, T>;
+
+    BasicFrame() = default;
+
+    //! Empty columns on the given index, days must be sorted and unique
+    explicit BasicFrame(std::vector<day_type> days) : days_(std::move(days)) {
+        Precondition(std::adjacent_find(days_.begin(), days_.end(), std::greater_equal<day_type>{}) == days_.end(),
+                     "Frame: index must be sorted and unique!");
+    }
+
+    //! Align maps on their common dates (inner) or on all their dates (outer, NaN filled)
+    static BasicFrame from_maps(const std::vector<const map_type*>& maps,
+                                std::vector<std::string> names = {},
+                                FrameJoin join = FrameJoin::inner) {
+        Precondition(names.empty() || names.size() == maps.size(), "Frame::from_maps: one name per map expected!");
+        BasicFrame f;
+        std::vector<typename map_type::const_iterator> it, last;
+        for (auto m : maps) { it.push_back(m->begin()); last.push_back(m->end()); }
+        f.columns_.resize(maps.size());
+        for (;;) {
+            // next date : smallest current key (outer) or common key (inner)
+            bool any = false, all = true;
+            date::day_point key{};
+            for (std::size_t m = 0; m < maps.size(); m ++) {
+                if (it[m] == last[m]) { all = false; continue; }
+                if (join == FrameJoin::outer ? (!any || it[m]->first < key) : (!any || key < it[m]->first)) {
+                    key = it[m]->first;
+                }
+                any = true;
+            }
+            if (!any || (join == FrameJoin::inner && !all)) { break; }
+            bool everywhere = true;
+            for (std::size_t m = 0; m < maps.size(); m ++) {
+                while (it[m] != last[m] && it[m]->first < key) { ++ it[m]; }
+                if (it[m] == last[m] || key < it[m]->first) { everywhere = false; }
+            }
+            if (join == FrameJoin::inner && !everywhere) { continue; }
+            f.days_.push_back(to_day(key));
+            for (std::size_t m = 0; m < maps.size(); m ++) {
+                if (it[m] != last[m] && !(key < it[m]->first)) {
+                    f.columns_[m].push_back(it[m]->second);
+                    ++ it[m];
+                }
+                else {
+                    f.columns_[m].push_back(missing());
+                }
+            }
+        }
+        f.names_ = std::move(names);
+        f.names_.resize(maps.size());
+        return f;
+    }
+
+    static BasicFrame from_maps(const std::vector<map_type*>& maps, std::vector<std::string> names = {},
+                                FrameJoin join = FrameJoin::inner) {
+        return from_maps(std::vector<const map_type*>(maps.begin(), maps.end()), std::move(names), join);
+    }
+
+    //! Column back to a map, missing values are skipped
+    map_type to_map(std::size_t col) const {
+        check_column(col);
+        map_type m;
+        auto const& c = columns_[col];
+        for (std::size_t i = 0; i < rows(); i ++) {
+            if (!is_missing(c[i])) { m.emplace_hint(m.end(), day(i), c[i]); }
+        }
+        return m;
+    }
+
+    std::vector<map_type> to_maps() const {
+        std::vector<map_type> maps;
+        for (std::size_t c = 0; c < cols(); c ++) { maps.push_back(to_map(c)); }
+        return maps;
+    }
+
+    std::size_t rows() const { return days_.size(); }
+    std::size_t cols() const { return columns_.size(); }
+
+    ColumnView<const day_type> index() const { return {days_.data(), days_.size()}; }
+    date::day_point day(std::size_t row) const { return date::day_point{date::days{days_[row]}}; }
+    const std::vector<std::string>& names() const { return names_; }
+
+    //! Row of a date, rows() if absent
+    std::size_t find_row(date::day_point d) const {
+        auto k = to_day(d);
+        auto it = std::lower_bound(days_.begin(), days_.end(), k);
+        return (it != days_.end() && *it == k) ? static_cast<std::size_t>(it - days_.begin()) : rows();
+    }
+
+    //! Rows [first row >= from, first row > to)
+    std::pair<std::size_t, std::size_t> row_range(date::day_point from, date::day_point to) const {
+        auto b = std::lower_bound(days_.begin(), days_.end(), to_day(from)) - days_.begin();
+        auto e = std::upper_bound(days_.begin(), days_.end(), to_day(to)) - days_.begin();
+        return {static_cast<std::size_t>(b), static_cast<std::size_t>(std::max(b, e))};
+    }
+
+    //! Zero copy access to the values of a column
+    ColumnView<T>       column(std::size_t col)       { check_column(col); return {columns_[col].data(), rows()}; }
+    ColumnView<const T> column(std::size_t col) const { check_column(col); return {columns_[col].data(), rows()}; }
+    ColumnView<T>       column(const std::string& name)       { return column(column_index(name)); }
+    ColumnView<const T> column(const std::string& name) const { return column(column_index(name)); }
+
+    std::size_t column_index(const std::string& name) const {
+        auto it = std::find(names_.begin(), names_.end(), name);
+        Precondition(it != names_.end(), "Frame: no column named " + name);
+        return static_cast<std::size_t>(it - names_.begin());
+    }
+
+    //! Add a column of rows() values, return its index
+    std::size_t add_column(std::string name, std::vector<T> values) {
+        Precondition(values.size() == rows(), "Frame::add_column: column size must match the index!");
+        names_.push_back(std::move(name));
+        columns_.push_back(std::move(values));
+        return cols() - 1;
+    }
+
+    //! Add a column from a map : dates absent from the map are missing, dates not in the index are ignored
+    std::size_t add_column(std::string name, const map_type& m) {
+        std::vector<T> values(rows(), missing());
+        auto it = m.begin();
+        for (std::size_t i = 0; i < rows() && it != m.end(); i ++) {
+            auto d = day(i);
+            while (it != m.end() && it->first < d) { ++ it; }
+            if (it != m.end() && !(d < it->first)) { values[i] = it->second; }
+        }
+        return add_column(std::move(name), std::move(values));
+    }
+
+    //! New column out[i] = op(a[i], b[i])
+    template<typename Op>
+    std::size_t add_column(std::string name, std::size_t a, std::size_t b, Op op) {
+        check_column(a);
+        auto values = columns_[a];
+        column_view_of(values).zip(column(b), op);
+        return add_column(std::move(name), std::move(values));
+    }
+
+    //! Keep the rows where no column is missing
+    void drop_missing() {
+        std::size_t w = 0;
+        for (std::size_t i = 0; i < rows(); i ++) {
+            bool keep = true;
+            for (auto const& c : columns_) { keep = keep && !is_missing(c[i]); }
+            if (!keep) { continue; }
+            days_[w] = days_[i];
+            for (auto& c : columns_) { c[w] = c[i]; }
+            ++ w;
+        }
+        days_.resize(w);
+        for (auto& c : columns_) { c.resize(w); }
+    }
+
+    static day_type to_day(date::day_point d) { return static_cast<day_type>(d.time_since_epoch().count()); }
+    static T missing() { return std::numeric_limits<T>::has_quiet_NaN ? std::numeric_limits<T>::quiet_NaN() : T{}; }
+    static bool is_missing(const T& v) { return std::numeric_limits<T>::has_quiet_NaN && v != v; }
+
+private:
+    static ColumnView<T> column_view_of(std::vector<T>& v) { return {v.data(), v.size()}; }
+
+    void check_column(std::size_t col) const {
+        Precondition(col < cols(), "Frame: column index out of range!");
+    }
+
+    std::vector<day_type>       days_;
+    std::vector<std::string>    names_;
+    std::vector<std::vector<T>> columns_;
+};
+
+using Frame = BasicFrame<double>;
+
+} // ns _impl_frame
+
+using _impl_frame::ColumnView;
+using _impl_frame::FrameJoin;
+using _impl_frame::BasicFrame;
+using _impl_frame::Frame;
+
+} // ns coin
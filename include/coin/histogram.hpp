@@ -0,0 +1,266 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <limits>
+
+namespace coin {
+
+namespace _impl_histogram {
+
+//! Index of the most significant bit set, v must not be 0
+inline unsigned msb_index(std::uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+    unsigned r = 0;
+    while (v >>= 1) { ++ r; }
+    return r;
+#endif
+}
+
+inline void write_varint(std::ostream& os, std::uint64_t v) {
+    char buf[10];
+    std::size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = static_cast<char>(v);
+    os.write(buf, static_cast<std::streamsize>(n));
+}
+
+inline std::uint64_t read_varint(std::istream& is) {
+    std::uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        auto c = is.get();
+        if (c == std::char_traits<char>::eof()) {
+            throw std::ios_base::failure("LatencyHistogram: truncated varint");
+        }
+        v |= static_cast<std::uint64_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) { return v; }
+    }
+    throw std::ios_base::failure("LatencyHistogram: malformed varint");
+}
+
+
+//! Log-bucketed latency histogram in the spirit of HdrHistogram.
+//! Values below 2^Precision are counted exactly, larger ones land in buckets
+//! whose relative width is at most 2^(1-Precision) (Precision=7 : ~1.6%).
+//! Memory is allocated once at construction; record() is a handful of relaxed
+//! atomic operations so several threads may feed the same histogram lock-free.
+//! Under heavy contention give each thread its own histogram and merge() them.
+template<unsigned Precision = 7>
+class LatencyHistogram {
+    static_assert(Precision >= 1 && Precision <= 16, "LatencyHistogram: Precision must be in [1,16]");
+public:
+    using value_type = std::uint64_t;
+    using count_type = std::uint64_t;
+
+    static constexpr std::size_t sub_bucket_count = std::size_t{1} << Precision;
+    static constexpr std::size_t half_bucket_count = sub_bucket_count / 2;
+    static constexpr std::size_t bucket_count = sub_bucket_count + (64 - Precision) * half_bucket_count;
+
+    LatencyHistogram() : state_{new State} { reset(); }
+
+    LatencyHistogram(LatencyHistogram&&)            = default;
+    LatencyHistogram& operator=(LatencyHistogram&&) = default;
+
+    static std::size_t bucket_index(value_type v) {
+        if (v < sub_bucket_count) {
+            return static_cast<std::size_t>(v);
+        }
+        auto shift = msb_index(v) - Precision + 1;
+        return sub_bucket_count + (shift - 1) * half_bucket_count
+            + static_cast<std::size_t>(v >> shift) - half_bucket_count;
+    }
+
+    static value_type lowest_equivalent_value(std::size_t index) {
+        if (index < sub_bucket_count) {
+            return index;
+        }
+        auto k = index - sub_bucket_count;
+        auto shift = k / half_bucket_count + 1;
+        auto sub = k % half_bucket_count + half_bucket_count;
+        return static_cast<value_type>(sub) << shift;
+    }
+
+    static value_type highest_equivalent_value(std::size_t index) {
+        if (index < sub_bucket_count) {
+            return index;
+        }
+        auto k = index - sub_bucket_count;
+        auto shift = k / half_bucket_count + 1;
+        return lowest_equivalent_value(index) + ((value_type{1} << shift) - 1);
+    }
+
+    void record(value_type v, count_type n = 1) noexcept {
+        auto& s = *state_;
+        s.counts[bucket_index(v)].fetch_add(n, std::memory_order_relaxed);
+        s.total.fetch_add(n, std::memory_order_relaxed);
+        s.sum.fetch_add(v * n, std::memory_order_relaxed);
+        update_min(v);
+        update_max(v);
+    }
+
+    //! Add all the counts of other into this histogram
+    void merge(const LatencyHistogram& other) {
+        if (other.count() == 0) { return; }
+        for (std::size_t i = 0; i < bucket_count; i ++) {
+            auto c = other.state_->counts[i].load(std::memory_order_relaxed);
+            if (c) {
+                state_->counts[i].fetch_add(c, std::memory_order_relaxed);
+            }
+        }
+        state_->total.fetch_add(other.count(), std::memory_order_relaxed);
+        state_->sum.fetch_add(other.state_->sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        update_min(other.min());
+        update_max(other.max());
+    }
+
+    void reset() noexcept {
+        auto& s = *state_;
+        for (auto& c : s.counts) { c.store(0, std::memory_order_relaxed); }
+        s.total.store(0, std::memory_order_relaxed);
+        s.sum.store(0, std::memory_order_relaxed);
+        s.min.store(std::numeric_limits<value_type>::max(), std::memory_order_relaxed);
+        s.max.store(0, std::memory_order_relaxed);
+    }
+
+    count_type count() const { return state_->total.load(std::memory_order_relaxed); }
+    value_type min()   const { return count() ? state_->min.load(std::memory_order_relaxed) : 0; }
+    value_type max()   const { return state_->max.load(std::memory_order_relaxed); }
+
+    double mean() const {
+        auto n = count();
+        return n ? static_cast<double>(state_->sum.load(std::memory_order_relaxed)) / n : 0.0;
+    }
+
+    count_type count_at_index(std::size_t index) const {
+        return state_->counts[index].load(std::memory_order_relaxed);
+    }
+
+    //! Smallest recorded value v such that p percent of the records are <= v (within bucket precision)
+    value_type value_at_percentile(double p) const {
+        auto n = count();
+        if (n == 0) { return 0; }
+        if (p < 0.0)   { p = 0.0; }
+        if (p > 100.0) { p = 100.0; }
+        auto rank = static_cast<count_type>(std::ceil(p / 100.0 * n));
+        if (rank == 0) { rank = 1; }
+        count_type cumulated = 0;
+        for (std::size_t i = 0; i < bucket_count; i ++) {
+            cumulated += count_at_index(i);
+            if (cumulated >= rank) {
+                auto v = highest_equivalent_value(i);
+                return v < max() ? v : max();
+            }
+        }
+        return max();
+    }
+
+    //! Compact binary encoding : header, then (index delta, count) varint pairs of non empty buckets
+    void serialize(std::ostream& os) const {
+        os.write("CH", 2);
+        os.put(static_cast<char>(Precision));
+        std::size_t non_empty = 0;
+        for (std::size_t i = 0; i < bucket_count; i ++) {
+            if (count_at_index(i)) { ++ non_empty; }
+        }
+        write_varint(os, count() ? min() : 0);
+        write_varint(os, max());
+        write_varint(os, state_->sum.load(std::memory_order_relaxed));
+        write_varint(os, non_empty);
+        std::size_t previous = 0;
+        for (std::size_t i = 0; i < bucket_count; i ++) {
+            auto c = count_at_index(i);
+            if (c) {
+                write_varint(os, i - previous);
+                write_varint(os, c);
+                previous = i;
+            }
+        }
+    }
+
+    static LatencyHistogram deserialize(std::istream& is) {
+        char header[3];
+        if (!is.read(header, 3) || header[0] != 'C' || header[1] != 'H') {
+            throw std::ios_base::failure("LatencyHistogram: bad header");
+        }
+        if (static_cast<unsigned>(header[2]) != Precision) {
+            throw std::ios_base::failure("LatencyHistogram: precision mismatch");
+        }
+        LatencyHistogram h;
+        auto& s = *h.state_;
+        auto mini = read_varint(is);
+        auto maxi = read_varint(is);
+        s.sum.store(read_varint(is), std::memory_order_relaxed);
+        auto non_empty = read_varint(is);
+        std::size_t index = 0;
+        count_type total = 0;
+        for (std::uint64_t k = 0; k < non_empty; k ++) {
+            index += static_cast<std::size_t>(read_varint(is));
+            if (index >= bucket_count) {
+                throw std::ios_base::failure("LatencyHistogram: bucket index out of range");
+            }
+            auto c = read_varint(is);
+            s.counts[index].store(c, std::memory_order_relaxed);
+            total += c;
+        }
+        s.total.store(total, std::memory_order_relaxed);
+        if (total) {
+            s.min.store(mini, std::memory_order_relaxed);
+            s.max.store(maxi, std::memory_order_relaxed);
+        }
+        return h;
+    }
+
+    std::string to_string() const {
+        using std::to_string;
+        return "count=" + to_string(count())
+            + " min="    + to_string(min())
+            + " mean="   + to_string(mean())
+            + " p50="    + to_string(value_at_percentile(50.0))
+            + " p90="    + to_string(value_at_percentile(90.0))
+            + " p99="    + to_string(value_at_percentile(99.0))
+            + " p99.9="  + to_string(value_at_percentile(99.9))
+            + " max="    + to_string(max());
+    }
+
+private:
+    struct State {
+        std::atomic<count_type> counts[bucket_count];
+        std::atomic<count_type> total;
+        std::atomic<value_type> sum;
+        std::atomic<value_type> min;
+        std::atomic<value_type> max;
+    };
+
+    void update_min(value_type v) noexcept {
+        auto current = state_->min.load(std::memory_order_relaxed);
+        while (v < current && !state_->min.compare_exchange_weak(current, v, std::memory_order_relaxed)) {}
+    }
+
+    void update_max(value_type v) noexcept {
+        auto current = state_->max.load(std::memory_order_relaxed);
+        while (v > current && !state_->max.compare_exchange_weak(current, v, std::memory_order_relaxed)) {}
+    }
+
+    std::unique_ptr<State> state_;
+};
+
+template<unsigned Precision> constexpr std::size_t LatencyHistogram<Precision>::sub_bucket_count;
+template<unsigned Precision> constexpr std::size_t LatencyHistogram<Precision>::half_bucket_count;
+template<unsigned Precision> constexpr std::size_t LatencyHistogram<Precision>::bucket_count;
+
+} // ns _impl_histogram
+
+using _impl_histogram::LatencyHistogram;
+
+} // ns coin
@@ -7,9 +7,13 @@
 #include <memory>
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <ios>
 #include <fstream>
 #include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 
 namespace coin {
 
@@ -31,44 +35,60 @@ double get_total_physical_memory() {
 }
 
 
-// process_mem_usage(double &, double &) - takes two doubles by reference,
-// attempts to read the system-dependent data for a process' virtual memory
-// size and resident set size, and return the results in GB.
-// On failure, returns 0.0, 0.0
-inline
-std::pair<double, double> process_mem_usage() {
-   using std::ios_base;
-   using std::ifstream;
-   using std::string;
-
-   double vm_usage     = 0.0;
-   double resident_set = 0.0;
-
-   // 'file' stat seems to give the most reliable results
-   ifstream stat_stream("/proc/self/stat",ios_base::in);
+namespace _detail {
 
-   // dummy vars for leading entries in stat that we don't care about
-   string pid, comm, state, ppid, pgrp, session, tty_nr;
-   string tpgid, flags, minflt, cminflt, majflt, cmajflt;
-   string utime, stime, cutime, cstime, priority, nice;
-   string O, itrealvalue, starttime;
+//! Read a small (/proc) file from its beginning with a single pread, return the length read
+inline
+std::size_t pread_file(int fd, char* buf, std::size_t size) {
+    if (fd < 0) { return 0; }
+    auto n = pread(fd, buf, size - 1, 0);
+    if (n <= 0) { return 0; }
+    buf[n] = '\0';
+    return static_cast<std::size_t>(n);
+}
 
-   // the two fields we want
-   unsigned long vsize;
-   long rss;
+//! Parse an unsigned decimal number after optional blanks, p is moved past it
+inline
+std::uint64_t parse_uint(const char*& p, const char* end) {
+    while (p != end && (*p == ' ' || *p == '\t')) { ++ p; }
+    std::uint64_t v = 0;
+    while (p != end && *p >= '0' && *p <= '9') {
+        v = v * 10 + static_cast<std::uint64_t>(*p - '0');
+        ++ p;
+    }
+    return v;
+}
 
-   stat_stream >> pid >> comm >> state >> ppid >> pgrp >> session >> tty_nr
-               >> tpgid >> flags >> minflt >> cminflt >> majflt >> cmajflt
-               >> utime >> stime >> cutime >> cstime >> priority >> nice
-               >> O >> itrealvalue >> starttime >> vsize >> rss; // don't care about the rest
+//! Value of a "key: number" line in a /proc text file, 0 if the key is absent
+inline
+std::uint64_t parse_proc_field(const char* buf, std::size_t len, const char* key) {
+    const char* end = buf + len;
+    const char* found = std::search(buf, end, key, key + std::strlen(key));
+    if (found == end) { return 0; }
+    const char* p = found + std::strlen(key);
+    return parse_uint(p, end);
+}
 
-   stat_stream.close();
+} // ns _detail
 
-   long page_size_kb = sysconf(_SC_PAGE_SIZE) / 1024; // in case x86-64 is configured to use 2MB pages
-   vm_usage     = (vsize / 1024.0) / 1024.0;
-   resident_set = (rss * page_size_kb) / 1024;
 
-   return {vm_usage, resident_set};
+// process_mem_usage() - reads /proc/self/statm (one pread, no stream, no string)
+// and returns the process' virtual memory size and resident set size in MB.
+// On failure, returns 0.0, 0.0
+inline
+std::pair<double, double> process_mem_usage() {
+    int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    char buf[128];
+    auto len = _detail::pread_file(fd, buf, sizeof(buf));
+    if (fd >= 0) { close(fd); }
+    if (len == 0) { return {0.0, 0.0}; }
+
+    const char* p = buf;
+    auto vm_pages  = _detail::parse_uint(p, buf + len);
+    auto rss_pages = _detail::parse_uint(p, buf + len);
+
+    double page_size_mb = sysconf(_SC_PAGE_SIZE) / (1024.0 * 1024.0);
+    return {vm_pages * page_size_mb, rss_pages * page_size_mb};
 }
 
 
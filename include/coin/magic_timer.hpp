@@ -3,8 +3,11 @@
 #include <chrono>
 #include <iostream>
 #include <string>
+#include <cstdint>
 
 #include "logger.hpp"
+#include "histogram.hpp"
+#include "tsc_clock.hpp"
 
 namespace coin {
 
@@ -22,10 +25,12 @@ template<> inline std::string suffix_duration<std::chrono::microseconds>() { ret
 template<> inline std::string suffix_duration<std::chrono::nanoseconds>()  { return "ns"; }
 
 
-template<LogLevel Level=coin::LogLevel::log_debug, typename TimeT = std::chrono::milliseconds>
+//! Clock may be any chrono clock, e.g. coin::tsc_clock for cheap sub-microsecond spans
+template<LogLevel Level=coin::LogLevel::log_debug, typename TimeT = std::chrono::milliseconds, 
+    typename Clock = std::chrono::high_resolution_clock>
 class Timer {
-    using clock = std::chrono::high_resolution_clock; 
-    clock::time_point begin_time_{clock::now()};
+    using clock = Clock; 
+    typename clock::time_point begin_time_{clock::now()};
     std::string label;
 public:
     Timer(const std::string& lbl = "") : label(lbl) {}
@@ -40,22 +45,43 @@ public:
 #endif
     }
 
-    auto stop() const ->  clock::time_point::rep {
+    //! Record the elapsed time (in TimeT units) into a histogram instead of logging it
+    template<unsigned Precision>
+    void end(LatencyHistogram<Precision>& sink) const {
+        auto duration = std::chrono::duration_cast<TimeT>(clock::now() - begin_time_).count();
+        sink.record(duration > 0 ? static_cast<std::uint64_t>(duration) : 0);
+    }
+
+    //! Elapsed time in TimeT units (a floating point TimeT keeps the fraction)
+    auto stop() const -> typename TimeT::rep {
         return std::chrono::duration_cast<TimeT>(clock::now() - begin_time_).count();
     }
 };
 
 
-template<LogLevel Level=coin::LogLevel::log_debug, typename TimeT = std::chrono::milliseconds>
+template<LogLevel Level=coin::LogLevel::log_debug, typename TimeT = std::chrono::milliseconds, 
+    typename Clock = std::chrono::high_resolution_clock>
 class TimerScope {
-    using clock = std::chrono::high_resolution_clock; 
-    clock::time_point begin_time_{clock::now()};
+    using clock = Clock; 
+    typename clock::time_point begin_time_{clock::now()};
     std::string label;
+    void* sink_{nullptr};
+    void (*record_)(void*, std::uint64_t){nullptr};
     TimerScope(const TimerScope& timer) = delete;
 public:
     TimerScope(const std::string& lbl = "") : label(lbl) {}
+    //! At end of scope the duration (in TimeT units) is recorded into sink, nothing is logged
+    template<unsigned Precision>
+    explicit TimerScope(LatencyHistogram<Precision>& sink) 
+        : sink_{&sink}
+        , record_{[](void* h, std::uint64_t v) { static_cast<LatencyHistogram<Precision>*>(h)->record(v); }}
+        {}
     ~TimerScope() {
         auto duration = std::chrono::duration_cast<TimeT>(clock::now() - begin_time_);
+        if (sink_) {
+            record_(sink_, duration.count() > 0 ? static_cast<std::uint64_t>(duration.count()) : 0);
+            return;
+        }
 #ifdef DISABLE_LOG
         std::cout << "[Timer] " 
             << label  << " : " << duration.count() << " " << suffix_duration<TimeT>() <<"\n";
@@ -71,9 +97,9 @@ public:
 /*
     Usage : std::cout << TimerFunc<std::chrono::microseconds>::exec<bool(unsigned int)>(isPrime, 7);
 */
-template<typename TimeT = std::chrono::milliseconds>
+template<typename TimeT = std::chrono::milliseconds, typename Clock = std::chrono::high_resolution_clock>
 struct TimerFunc {
-    using clock = std::chrono::high_resolution_clock;
+    using clock = Clock;
     template<typename F, typename ...Args>
     static typename TimeT::rep exec(F func, Args&&... args) {
         auto start = clock::now();
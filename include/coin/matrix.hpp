@@ -7,6 +7,8 @@
 #include <algorithm> // std::copy
 #include <stdexcept>
 
+#include "pretty_print.hpp"
+
 namespace coin { 
 
 namespace _impl_matrix {
@@ -69,10 +71,12 @@ public:
     auto to_string() const {
         using std::to_string;
         std::string str = to_string(rows()) + "x" + to_string(cols()) + "\n";
+        _impl_stringify::StringSink sink{str};
         size_type i{0};
         for (const auto& el : data_) {
-            str += to_string(el) + " ";
-            if (!(++i % cols())) { str += "\n"; }
+            _impl_stringify::write_value(sink, el);
+            sink.put(' ');
+            if (!(++i % cols())) { sink.put('\n'); }
         }
         return str;
     }
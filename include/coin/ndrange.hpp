@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "except.hpp"
+
+namespace coin {
+
+namespace _impl_ndrange {
+
+constexpr std::size_t dynamic_rank = 0;
+
+template<typename T, std::size_t Rank>
+struct index_storage {
+    using type = std::array<T, Rank>;
+    static type make(std::size_t) { return type{}; }
+};
+
+template<typename T>
+struct index_storage<T, dynamic_rank> {
+    using type = std::vector<T>;
+    static type make(std::size_t n) { return type(n); }
+};
+
+template<typename T, std::size_t Rank>
+class NdRange;
+
+//! Forward iterator over the points of an NdRange (random access through +=, -, [k] of the range).
+//! Incrementing is the odometer step of multi_dim_counter, the position is kept aside for comparisons.
+template<typename T, std::size_t Rank>
+class NdIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using index_type        = typename index_storage<T, Rank>::type;
+    using value_type        = index_type;
+    using difference_type   = std::ptrdiff_t;
+    using reference         = const index_type&;
+    using pointer           = const index_type*;
+
+    NdIterator() = default;
+    NdIterator(const NdRange<T, Rank>* range, std::uint64_t pos) : range_{range}, pos_{pos} {
+        if (pos_ < range_->size()) { current_ = range_->decode(pos_); }
+    }
+
+    reference operator*()  const { return current_; }
+    pointer   operator->() const { return &current_; }
+
+    NdIterator& operator++() {
+        if (++ pos_ < range_->size()) { range_->advance(current_); }
+        return *this;
+    }
+    NdIterator operator++(int) { auto tmp = *this; ++ *this; return tmp; }
+
+    NdIterator& operator+=(difference_type n) { return *this = NdIterator{range_, pos_ + static_cast<std::uint64_t>(n)}; }
+    NdIterator operator+(difference_type n) const { auto tmp = *this; return tmp += n; }
+    difference_type operator-(const NdIterator& o) const { return static_cast<difference_type>(pos_ - o.pos_); }
+
+    //! Linear position of the current point in the range
+    std::uint64_t position() const { return pos_; }
+
+    bool operator==(const NdIterator& o) const { return pos_ == o.pos_; }
+    bool operator!=(const NdIterator& o) const { return pos_ != o.pos_; }
+    bool operator<(const NdIterator& o)  const { return pos_ < o.pos_; }
+
+private:
+    const NdRange<T, Rank>* range_{nullptr};
+    std::uint64_t           pos_{0};
+    index_type              current_{};
+};
+
+
+//! Points [first,last) (linear positions) of an NdRange : a chunk given to one thread
+template<typename T, std::size_t Rank>
+class NdSlice {
+public:
+    using iterator   = NdIterator<T, Rank>;
+    using index_type = typename iterator::index_type;
+
+    NdSlice(const NdRange<T, Rank>* range, std::uint64_t first, std::uint64_t last)
+        : range_{range}, first_{first}, last_{last} {}
+
+    iterator      begin() const { return {range_, first_}; }
+    iterator      end()   const { return {range_, last_}; }
+    std::uint64_t first() const { return first_; }
+    std::uint64_t last()  const { return last_; }
+    std::uint64_t size()  const { return last_ - first_; }
+
+    template<typename F> void for_each(F&& f)     const { range_->for_each(first_, last_, f); }
+    template<typename F> void for_each_row(F&& f) const { range_->for_each_row(first_, last_, f); }
+
+private:
+    const NdRange<T, Rank>* range_;
+    std::uint64_t           first_;
+    std::uint64_t           last_;
+};
+
+
+//! The points of the box [lower, upper] (bounds included, as multi_dim_counter) in the
+//! same order : last dimension fastest. Rank fixed at compile time (index is a std::array)
+//! or dynamic_rank (std::vector). The k-th point is a mixed radix decode of k, so the range
+//! can be split in chunks enumerated independently.
+//!     for (auto const& p : coin::NdRange<int, 3>{{-4,-1,1}, {-3,1,2}}) { ... }
+//!     range.for_each_row([](auto const& p, int first, int last) { ... }); // p[rank-1] not set
+template<typename T, std::size_t Rank = dynamic_rank>
+class NdRange {
+    static_assert(std::is_integral<T>::value, "NdRange: coordinates must be integers");
+
+public:
+    using iterator   = NdIterator<T, Rank>;
+    using slice      = NdSlice<T, Rank>;
+    using index_type = typename index_storage<T, Rank>::type;
+
+    NdRange(index_type lower, index_type upper) : lower_(std::move(lower)), upper_(std::move(upper)) {
+        Precondition(lower_.size() == upper_.size(), "NdRange: lower and upper must have the same rank!");
+        Precondition(lower_.size() > 0, "NdRange: rank must be at least 1!");
+        extent_ = index_storage<std::uint64_t, Rank>::make(lower_.size());
+        size_ = 1;
+        for (std::size_t d = 0; d < rank(); d ++) {
+            if (upper_[d] < lower_[d]) { size_ = 0; }
+            extent_[d] = upper_[d] < lower_[d] ? 0 : static_cast<std::uint64_t>(static_cast<std::int64_t>(upper_[d]) - static_cast<std::int64_t>(lower_[d])) + 1;
+            Precondition(extent_[d] == 0 || size_ <= std::numeric_limits<std::uint64_t>::max() / extent_[d], "NdRange: too many points!");
+            size_ *= extent_[d];
+        }
+    }
+
+    std::size_t       rank()  const { return lower_.size(); }
+    std::uint64_t     size()  const { return size_; }
+    bool              empty() const { return size_ == 0; }
+    const index_type& lower() const { return lower_; }
+    const index_type& upper() const { return upper_; }
+
+    iterator begin() const { return {this, 0}; }
+    iterator end()   const { return {this, size_}; }
+
+    //! k-th point (mixed radix decode, last dimension least significant)
+    index_type operator[](std::uint64_t k) const { return decode(k); }
+    index_type at(std::uint64_t k) const {
+        Precondition(k < size_, "NdRange::at: position out of range!");
+        return decode(k);
+    }
+
+    //! Position of a point, inverse of operator[]
+    std::uint64_t position(const index_type& p) const {
+        std::uint64_t k = 0;
+        for (std::size_t d = 0; d < rank(); d ++) {
+            k = k * extent_[d] + static_cast<std::uint64_t>(static_cast<std::int64_t>(p[d]) - static_cast<std::int64_t>(lower_[d]));
+        }
+        return k;
+    }
+
+    slice all() const { return {this, 0, size_}; }
+    slice sub(std::uint64_t first, std::uint64_t last) const {
+        Precondition(first <= last && last <= size_, "NdRange::sub: range out of bounds!");
+        return {this, first, last};
+    }
+
+    //! At most `parts` slices of about the same size covering the range. With `whole_rows`
+    //! the cuts fall on rows of the last dimension so for_each_row never gets a partial row.
+    std::vector<slice> split(std::size_t parts, bool whole_rows = false) const {
+        std::vector<slice> out;
+        if (size_ == 0 || parts == 0) { return out; }
+        auto unit  = whole_rows ? extent_.back() : 1;
+        auto units = size_ / unit;
+        auto n     = std::min<std::uint64_t>(parts, units);
+        for (std::uint64_t i = 0; i < n; i ++) {
+            out.emplace_back(this, units * i / n * unit, units * (i + 1) / n * unit);
+        }
+        return out;
+    }
+
+    //! f(point) for every point, the carry logic runs once per row only
+    template<typename F>
+    void for_each(F&& f) const { for_each(0, size_, f); }
+
+    template<typename F>
+    void for_each(std::uint64_t first, std::uint64_t last, F&& f) const {
+        auto const inner = rank() - 1;
+        for_each_row(first, last, [&f, inner](index_type& p, T b, T e) {
+            for (T v = b; ; ++ v) {
+                p[inner] = v;
+                f(static_cast<const index_type&>(p));
+                if (v == e) { break; }
+            }
+        });
+    }
+
+    //! f(point, first, last) once per row of the last dimension : the caller loops over
+    //! [first, last] (included) itself, the index vector is not written for each point
+    template<typename F>
+    void for_each_row(F&& f) const { for_each_row(0, size_, f); }
+
+    template<typename F>
+    void for_each_row(std::uint64_t first, std::uint64_t last, F&& f) const {
+        if (first >= last) { return; }
+        auto const inner = rank() - 1;
+        auto const width = extent_[inner];
+        auto p = decode(first);
+        auto pos = first;
+        while (pos < last) {
+            auto offset = static_cast<std::uint64_t>(static_cast<std::int64_t>(p[inner]) - static_cast<std::int64_t>(lower_[inner]));
+            auto count  = std::min(width - offset, last - pos);
+            auto e = static_cast<T>(p[inner] + static_cast<T>(count - 1));
+            f(p, p[inner], e);
+            pos += count;
+            if (pos < last) {
+                p[inner] = upper_[inner];
+                advance(p);
+            }
+        }
+    }
+
+private:
+    friend class NdIterator<T, Rank>;
+
+    index_type decode(std::uint64_t k) const {
+        auto p = lower_;
+        for (auto d = rank(); d-- > 0; ) {
+            p[d] = static_cast<T>(lower_[d] + static_cast<T>(k % extent_[d]));
+            k /= extent_[d];
+        }
+        return p;
+    }
+
+    // odometer step, the caller checks the end
+    void advance(index_type& p) const {
+        for (auto d = rank(); d-- > 0; ) {
+            if (p[d] != upper_[d]) {
+                ++ p[d];
+                return;
+            }
+            p[d] = lower_[d];
+        }
+    }
+
+    index_type                                    lower_;
+    index_type                                    upper_;
+    typename index_storage<std::uint64_t, Rank>::type extent_{};
+    std::uint64_t                                 size_{0};
+};
+
+} // ns _impl_ndrange
+
+using _impl_ndrange::dynamic_rank;
+using _impl_ndrange::NdRange;
+using _impl_ndrange::NdSlice;
+using _impl_ndrange::NdIterator;
+
+} // ns coin
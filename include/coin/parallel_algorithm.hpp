@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "thread_pool.hpp"
+
+namespace coin {
+
+namespace _impl_parallel {
+
+//! Execution policy tags for the algorithm.hpp helpers
+struct sequential_policy {};
+
+//! Below `threshold` elements the serial version is used, `pool` defaults to shared_thread_pool()
+struct parallel_policy {
+    std::size_t threshold{std::size_t{1} << 15};
+    ThreadPool* pool{nullptr};
+
+    ThreadPool& executor() const { return pool ? *pool : shared_thread_pool(); }
+    parallel_policy with_threshold(std::size_t t) const { return parallel_policy{t, pool}; }
+    parallel_policy on(ThreadPool& p) const { return parallel_policy{threshold, &p}; }
+};
+
+constexpr sequential_policy seq{};
+constexpr parallel_policy   par{};
+
+
+//! [b,e) bounds of `parts` nearly equal chunks of n elements
+inline std::vector<std::size_t> split_bounds(std::size_t n, std::size_t parts) {
+    std::vector<std::size_t> bounds(parts + 1);
+    for (std::size_t k = 0; k <= parts; k ++) {
+        bounds[k] = n * k / parts;
+    }
+    return bounds;
+}
+
+//! Sort [first,last) : chunks sorted concurrently then merged pairwise, one merge round at a time
+template<class RandomIt>
+void parallel_sort(ThreadPool& pool, RandomIt first, RandomIt last) {
+    auto n = static_cast<std::size_t>(std::distance(first, last));
+    auto parts = std::max<std::size_t>(1, std::min(pool.size() * 2, n));
+    auto bounds = split_bounds(n, parts);
+    pool.parallel_for(0, parts, 1, [&](std::size_t k) {
+        std::sort(first + bounds[k], first + bounds[k + 1]);
+    });
+    for (std::size_t width = 1; width < parts; width *= 2) {
+        auto merges = (parts + 2 * width - 1) / (2 * width);
+        pool.parallel_for(0, merges, 1, [&](std::size_t m) {
+            auto lo  = m * 2 * width;
+            auto mid = std::min(lo + width, parts);
+            auto hi  = std::min(lo + 2 * width, parts);
+            if (mid < hi) {
+                std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi]);
+            }
+        });
+    }
+}
+
+} // ns _impl_parallel
+
+using _impl_parallel::sequential_policy;
+using _impl_parallel::parallel_policy;
+using _impl_parallel::seq;
+using _impl_parallel::par;
+using _impl_parallel::parallel_sort;
+
+
+template<typename Container>
+void remove_duplicate(const sequential_policy&, Container& cont) {
+    remove_duplicate(cont);
+}
+
+//! Parallel sort then unique, same result as remove_duplicate(cont)
+template<typename Container>
+void remove_duplicate(const parallel_policy& policy, Container& cont) {
+    using std::begin; using std::end;
+    if (cont.size() < policy.threshold) {
+        remove_duplicate(cont);
+        return;
+    }
+    parallel_sort(policy.executor(), begin(cont), end(cont));
+    cont.erase(std::unique(begin(cont), end(cont)), end(cont));
+}
+
+
+template<class Container>
+auto create_reverse_index(const sequential_policy&, const Container& cont)
+-> std::unordered_map<typename Container::value_type, size_t> {
+    return create_reverse_index(cont);
+}
+
+// No parallel_policy overload : std::unordered_map allocates one node per key and C++14 has no
+// node merge, gathering partitions built concurrently costs more than the serial build. Use
+// create_flat_reverse_index(par, cont).
+
+template<class Container>
+auto create_flat_reverse_index(const sequential_policy&, const Container& cont)
+-> flat_hash_map<typename Container::value_type, size_t> {
+    return create_flat_reverse_index(cont);
+}
+
+//! Partitioned build into flat_hash_map : one pass hashes the chunks concurrently and buckets the
+//! (hash, index) by partition, each task then builds the map of its partition keeping the hash
+//! next to the index, and the final merge places keys known to be distinct with that hash.
+template<class Container>
+auto create_flat_reverse_index(const parallel_policy& policy, const Container& cont)
+-> flat_hash_map<typename Container::value_type, size_t> {
+    using key_type = typename Container::value_type;
+    using map_type = flat_hash_map<key_type, size_t>;
+    using hashed   = std::pair<std::size_t, std::size_t>; // hash, index
+    auto& pool = policy.executor();
+    auto parts = pool.size();
+    if (cont.size() < policy.threshold || parts < 2) {
+        return create_flat_reverse_index(cont);
+    }
+    auto n = cont.size();
+    auto bounds = _impl_parallel::split_bounds(n, parts);
+    map_type reverse_index;
+
+    // buckets[c][p] : indices of chunk c falling in partition p, in increasing order.
+    // Partition on the high bits, the table uses the low ones
+    std::vector<std::vector<std::vector<hashed>>> buckets(parts, std::vector<std::vector<hashed>>(parts));
+    pool.parallel_for(0, parts, 1, [&](std::size_t c) {
+        for (auto& b : buckets[c]) { b.reserve((bounds[c + 1] - bounds[c]) / parts + 1); }
+        for (auto i = bounds[c]; i < bounds[c + 1]; i ++) {
+            auto h = reverse_index.hash_of(cont[i]);
+            buckets[c][(h >> 32) % parts].emplace_back(h, i);
+        }
+    });
+
+    // chunks in order : later indices win as in the serial version
+    std::vector<flat_hash_map<key_type, hashed>> partitions(parts);
+    pool.parallel_for(0, parts, 1, [&](std::size_t p) {
+        std::size_t count = 0;
+        for (std::size_t c = 0; c < parts; c ++) { count += buckets[c][p].size(); }
+        auto& m = partitions[p];
+        m.reserve(count);
+        for (std::size_t c = 0; c < parts; c ++) {
+            for (auto const& hi : buckets[c][p]) { m.try_emplace_hashed(hi.first, cont[hi.second]).first->second = hi; }
+            std::vector<hashed>{}.swap(buckets[c][p]);
+        }
+    });
+
+    std::size_t total = 0;
+    for (auto const& m : partitions) { total += m.size(); }
+    reverse_index.reserve(total);
+    for (auto& m : partitions) {
+        for (auto const& kv : m) {
+            reverse_index.insert_unique_hashed(kv.second.first, typename map_type::value_type(kv.first, kv.second.second));
+        }
+        m = flat_hash_map<key_type, hashed>{};
+    }
+    return reverse_index;
+}
+
+
+template<typename T>
+std::vector<T> give_difference(const sequential_policy&, const std::vector<T>& u, const std::vector<T>& v) {
+    return give_difference(u, v);
+}
+
+//! Parallel set difference of two sorted vectors : u is cut in chunks (never between equal
+//! elements), each chunk is diffed against the matching range of v, results are concatenated
+template<typename T>
+std::vector<T> give_difference(const parallel_policy& policy, const std::vector<T>& u, const std::vector<T>& v) {
+    if (u.size() < policy.threshold) {
+        return give_difference(u, v);
+    }
+    auto& pool = policy.executor();
+    auto parts = pool.size() * 4;
+    auto bounds = _impl_parallel::split_bounds(u.size(), parts);
+    for (std::size_t k = 1; k < parts; k ++) {
+        bounds[k] = std::max(bounds[k], bounds[k - 1]);
+        while (bounds[k] < u.size() && bounds[k] > 0 && !(u[bounds[k] - 1] < u[bounds[k]])) { ++ bounds[k]; }
+    }
+
+    std::vector<std::vector<T>> pieces(parts);
+    pool.parallel_for(0, parts, 1, [&](std::size_t k) {
+        auto ub = u.begin() + bounds[k];
+        auto ue = u.begin() + bounds[k + 1];
+        if (ub == ue) { return; }
+        auto vb = std::lower_bound(v.begin(), v.end(), *ub);
+        auto ve = ue == u.end() ? v.end() : std::lower_bound(vb, v.end(), *ue);
+        std::set_difference(ub, ue, vb, ve, std::back_inserter(pieces[k]));
+    });
+
+    std::vector<std::size_t> offsets(parts + 1, 0);
+    for (std::size_t k = 0; k < parts; k ++) { offsets[k + 1] = offsets[k] + pieces[k].size(); }
+    std::vector<T> diff(offsets[parts]);
+    pool.parallel_for(0, parts, 1, [&](std::size_t k) {
+        std::move(pieces[k].begin(), pieces[k].end(), diff.begin() + offsets[k]);
+    });
+    return diff;
+}
+
+} // ns coin
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+#include "magic_timer.hpp"
+
+namespace coin {
+
+namespace _impl_perf {
+
+enum class PerfEvent : std::uint8_t {
+    cycles, instructions, l1d_read_misses, llc_references, llc_misses, branches, branch_misses
+};
+
+constexpr std::size_t k_perf_event_count = 7;
+
+//! Counter values (or differences) of a PerfCounterGroup, missing counters are flagged in `has`
+struct PerfCounts {
+    std::array<std::uint64_t, k_perf_event_count> value{};
+    std::array<bool, k_perf_event_count>          has{};
+
+    bool          contains(PerfEvent e) const { return has[static_cast<std::size_t>(e)]; }
+    std::uint64_t operator[](PerfEvent e) const { return value[static_cast<std::size_t>(e)]; }
+
+    double ratio(PerfEvent num, PerfEvent den) const {
+        if (!contains(num) || !contains(den) || (*this)[den] == 0) { return -1.0; }
+        return static_cast<double>((*this)[num]) / static_cast<double>((*this)[den]);
+    }
+
+    //! Instructions per cycle, negative when not measured
+    double ipc()              const { return ratio(PerfEvent::instructions, PerfEvent::cycles); }
+    double llc_miss_rate()    const { return ratio(PerfEvent::llc_misses, PerfEvent::llc_references); }
+    double branch_miss_rate() const { return ratio(PerfEvent::branch_misses, PerfEvent::branches); }
+    //! L1 data read misses per thousand instructions
+    double l1d_mpki()         const {
+        auto r = ratio(PerfEvent::l1d_read_misses, PerfEvent::instructions);
+        return r < 0 ? r : r * 1000.0;
+    }
+
+    std::string to_string() const {
+        auto fmt = [](const char* name, double v, double scale, const char* suffix) {
+            if (v < 0) { return std::string{}; }
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), " | %s %.2f%s", name, v * scale, suffix);
+            return std::string{buf};
+        };
+        return fmt("IPC", ipc(), 1.0, "")
+            + fmt("L1d MPKI", l1d_mpki(), 1.0, "")
+            + fmt("LLC miss", llc_miss_rate(), 100.0, "%")
+            + fmt("branch miss", branch_miss_rate(), 100.0, "%");
+    }
+};
+
+inline PerfCounts operator-(const PerfCounts& lhs, const PerfCounts& rhs) {
+    PerfCounts diff;
+    for (std::size_t i = 0; i < k_perf_event_count; i ++) {
+        diff.has[i] = lhs.has[i] && rhs.has[i];
+        diff.value[i] = diff.has[i] ? lhs.value[i] - rhs.value[i] : 0;
+    }
+    return diff;
+}
+
+
+//! Group of hardware counters for the calling thread opened with perf_event_open.
+//! Counters the kernel or the cpu refuse are skipped; if even the cycle counter
+//! cannot be opened (no perf support, perf_event_paranoid, container...) the
+//! group is simply not available() and read() returns empty counts.
+class PerfCounterGroup {
+public:
+    PerfCounterGroup() {
+        fds_.fill(-1);
+#ifdef __linux__
+        for (std::size_t i = 0; i < k_perf_event_count; i ++) {
+            int fd = open_event(static_cast<PerfEvent>(i), fds_[0]);
+            if (i == 0 && fd < 0) { return; } // no leader, no group
+            if (fd >= 0) {
+                fds_[i] = fd;
+                slot_[nr_++] = i;
+            }
+        }
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    ~PerfCounterGroup() {
+#ifdef __linux__
+        for (auto fd : fds_) { if (fd >= 0) { close(fd); } }
+#endif
+    }
+
+    PerfCounterGroup(const PerfCounterGroup&)            = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    bool available() const { return fds_[0] >= 0; }
+
+    //! Current counter values, scaled when the kernel had to multiplex them
+    PerfCounts read() const {
+        PerfCounts counts;
+#ifdef __linux__
+        if (!available()) { return counts; }
+        std::uint64_t buf[3 + k_perf_event_count];
+        auto n = ::read(fds_[0], buf, sizeof(buf));
+        if (n < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) { return counts; }
+        auto nr = buf[0] < nr_ ? buf[0] : nr_;
+        double scale = (buf[2] > 0 && buf[2] < buf[1]) ? static_cast<double>(buf[1]) / buf[2] : 1.0;
+        for (std::size_t k = 0; k < nr; k ++) {
+            counts.has[slot_[k]] = true;
+            counts.value[slot_[k]] = static_cast<std::uint64_t>(buf[3 + k] * scale);
+        }
+#endif
+        return counts;
+    }
+
+private:
+#ifdef __linux__
+    static int open_event(PerfEvent event, int group_fd) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (event) {
+        case PerfEvent::cycles:          attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case PerfEvent::instructions:    attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case PerfEvent::llc_references:  attr.config = PERF_COUNT_HW_CACHE_REFERENCES; break;
+        case PerfEvent::llc_misses:      attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case PerfEvent::branches:        attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS; break;
+        case PerfEvent::branch_misses:   attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case PerfEvent::l1d_read_misses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        }
+        attr.disabled = group_fd < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+#endif
+
+    std::array<int, k_perf_event_count>         fds_;
+    std::array<std::size_t, k_perf_event_count> slot_{};  // group read position -> PerfEvent
+    std::size_t                                 nr_{0};
+};
+
+
+//! Like TimerScope but also logs IPC and miss rates measured over the scope.
+//! Pass a PerfCounterGroup to reuse already opened counters (saves ~7 syscalls per scope).
+template<LogLevel Level=coin::LogLevel::log_debug, typename TimeT = std::chrono::milliseconds,
+    typename Clock = std::chrono::high_resolution_clock>
+class PerfScope {
+    using clock = Clock;
+public:
+    explicit PerfScope(const std::string& lbl = "")
+        : owned_{new PerfCounterGroup}, group_{*owned_}, label_(lbl) { start(); }
+    PerfScope(PerfCounterGroup& group, const std::string& lbl = "")
+        : group_{group}, label_(lbl) { start(); }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+    //! Counter differences since the beginning of the scope
+    PerfCounts counts() const { return group_.read() - begin_counts_; }
+
+    ~PerfScope() {
+        auto diff = counts();
+        auto duration = std::chrono::duration_cast<TimeT>(clock::now() - begin_time_);
+        auto rates = group_.available() ? diff.to_string() : std::string{" | perf unavailable"};
+#ifdef DISABLE_LOG
+        std::cout << "[Perf] "
+            << label_  << " : " << duration.count() << " " << _detail_timer::suffix_duration<TimeT>() << rates << "\n";
+#else
+        coin::_detail::Log<Level>(std::cout) << "[Perf] "
+            << label_  << " : " << duration.count() << " " << _detail_timer::suffix_duration<TimeT>() << rates << "\n";
+#endif
+    }
+
+private:
+    void start() {
+        begin_counts_ = group_.read();
+        begin_time_ = clock::now();
+    }
+
+    std::unique_ptr<PerfCounterGroup> owned_;
+    PerfCounterGroup&                 group_;
+    std::string                       label_;
+    PerfCounts                        begin_counts_;
+    typename clock::time_point        begin_time_;
+};
+
+} // ns _impl_perf
+
+using _impl_perf::PerfEvent;
+using _impl_perf::PerfCounts;
+using _impl_perf::PerfCounterGroup;
+using _impl_perf::PerfScope;
+
+} // ns coin
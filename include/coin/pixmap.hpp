@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <cstdint>
+#include <limits>
 
 #include <vector>
 #include <array>
@@ -9,10 +13,14 @@
 #include <utility>
 #include <string>
 #include <fstream>
+#include <istream>
+#include <ostream>
 #include <functional>
 #include <iterator>
 #include <numeric>
 
+#include "pretty_print.hpp"
+
 namespace pixmap {
 
     enum class Anymap : std::uint8_t { PBM, PGM, PPM };
@@ -34,19 +42,6 @@ namespace std {
             return std::hash<type>()(static_cast<type>(x));
         }
     };
-
-    template<typename T>
-    std::ostream& operator<<(std::ostream& os, const std::vector<T>& vec) {
-        using namespace std;
-        std::copy(vec.begin(), vec.end(), std::ostream_iterator<T>(os, " "));
-        return os;
-    }
-    template<typename T>
-    std::istream& operator>>(std::istream& is, std::vector<T>& vec) {
-        using namespace std;
-        std::copy(std::istream_iterator<T>(is), std::istream_iterator<T>(), std::back_inserter(vec));
-        return is;
-    }
 } // namespace std
 
 namespace pixmap {
@@ -68,13 +63,204 @@ namespace impl_pixmap_ {
         { { Anymap::PBM, Format::BIN }, 4 }, { { Anymap::PGM, Format::BIN }, 5 }, { { Anymap::PPM, Format::BIN }, 6 }
     };
 
+    // index : magic number - 1
     static std::array<std::pair<Anymap, Format>, 6> map_magic_num_reverse{ {
-        { Anymap::PBM, Format::BIN   }, { Anymap::PGM, Format::BIN   }, { Anymap::PPM, Format::BIN   },
-        { Anymap::PBM, Format::ASCII }, { Anymap::PGM, Format::ASCII }, { Anymap::PPM, Format::ASCII }
+        { Anymap::PBM, Format::ASCII }, { Anymap::PGM, Format::ASCII }, { Anymap::PPM, Format::ASCII },
+        { Anymap::PBM, Format::BIN   }, { Anymap::PGM, Format::BIN   }, { Anymap::PPM, Format::BIN   }
         } 
     };
 
-    // Binary files and comments are not handled here
+    constexpr std::size_t samples_per_pixel(Anymap P) { return P == Anymap::PPM ? 3 : 1; }
+
+    template<Format F> using format_tag = std::integral_constant<Format, F>;
+
+
+    // header : magic number, width, height and max value (not for PBM) separated by
+    // whitespaces or comments, then a single whitespace before the raster
+
+    inline void skip_header_space(std::istream& is) {
+        for (auto c = is.peek(); c != std::char_traits<char>::eof(); c = is.peek()) {
+            if (c == '#') { is.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); }
+            else if (std::isspace(c)) { is.get(); }
+            else { break; }
+        }
+    }
+
+    // width and height above are rejected : the raster is read by chunks of rows, one row
+    // must stay a reasonable allocation whatever the header says
+    constexpr std::size_t max_dimension = std::size_t{1} << 20;
+
+    //! Unsigned decimal, no sign (operator>> would wrap "-1" to SIZE_MAX)
+    inline bool read_header_value(std::istream& is, std::size_t& value) {
+        skip_header_space(is);
+        auto c = is.peek();
+        if (c == std::char_traits<char>::eof() || c < '0' || c > '9') { return false; }
+        return static_cast<bool>(is >> value);
+    }
+
+    inline bool read_magic_number(std::istream& is, Anymap P, Format F, std::string& magic_number) {
+        char p{0}, n{0};
+        if (!(is >> p >> n) || p != 'P' || n < '1' || n > '6') { return false; }
+        magic_number = { p, n };
+        return map_magic_num_reverse[static_cast<std::size_t>(n - '1')] == std::make_pair(P, F);
+    }
+
+
+    // P1, P2, P3 : whitespace separated numbers, lines of at most 70 characters. Numbers are
+    // formatted into a large buffer and parsed straight from the stream buffer, without the
+    // locale and sentry of operator<< / operator>> for each value
+
+    constexpr std::size_t plain_line_max = 70;
+
+    inline bool is_plain_space(int c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f'; }
+    inline bool is_plain_digit(int c) { return c >= '0' && c <= '9'; }
+
+    // max 65535 : the five digits are assembled in a register and eight bytes are stored,
+    // the first n are the number (no branch on the length)
+    inline std::size_t format_sample(char* out, unsigned v) {
+        auto pairs = coin::_impl_stringify::digit_pairs();
+        std::size_t n = 1 + (v >= 10) + (v >= 100) + (v >= 1000) + (v >= 10000);
+        auto low = v % 10000;
+        auto mid = pairs + low / 100 * 2;
+        auto end = pairs + low % 100 * 2;
+        std::uint64_t digits = static_cast<std::uint64_t>('0' + v / 10000)
+            | static_cast<std::uint64_t>(static_cast<unsigned char>(mid[0])) << 8
+            | static_cast<std::uint64_t>(static_cast<unsigned char>(mid[1])) << 16
+            | static_cast<std::uint64_t>(static_cast<unsigned char>(end[0])) << 24
+            | static_cast<std::uint64_t>(static_cast<unsigned char>(end[1])) << 32;
+        digits >>= 8 * (5 - n);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (auto k = 0; k < 8; k ++) { out[k] = static_cast<char>(digits >> (8 * k)); }
+#else
+        std::memcpy(out, &digits, 8);
+#endif
+        return n;
+    }
+
+    template<typename T>
+    void write_raster(std::ostream& os, const std::vector<T>& data, std::size_t, std::uint16_t, format_tag<Format::ASCII>) {
+        std::vector<char> buf(1 << 16);
+        auto const out  = buf.data();
+        auto const last = buf.size() - 16;
+        std::size_t used{0}, line{0};
+        for (auto it = data.begin(); it != data.end(); ++ it) {
+            if (used > last) {
+                os.write(out, static_cast<std::streamsize>(used));
+                used = 0;
+            }
+            auto n = format_sample(out + used, static_cast<unsigned>(*it));
+            used += n;
+            line += n;
+            // new line when the next number might not fit
+            auto wrap = line + 6 > plain_line_max;
+            out[used ++] = wrap ? '\n' : ' ';
+            line = wrap ? 0 : line + 1;
+        }
+        if (used) { out[used - 1] = '\n'; }
+        os.write(out, static_cast<std::streamsize>(used));
+    }
+
+    // readers fill data[first, data.size()), whole rows of row_samples samples, and set
+    // failbit on short data or a sample above max_val
+
+    //! P1 pixels need no separator
+    template<typename T>
+    void read_raster(std::istream& is, std::vector<T>& data, std::size_t first, std::size_t, std::uint16_t max_val, format_tag<Format::ASCII>) {
+        auto sb  = is.rdbuf();
+        auto eof = std::char_traits<char>::eof();
+        auto one_digit = std::is_same<T, bool>::value;
+        for (std::size_t i = first; i < data.size(); i ++) {
+            auto c = sb->sgetc();
+            while (c != eof && is_plain_space(c)) { c = sb->snextc(); }
+            if (c == eof || !is_plain_digit(c)) {
+                is.setstate(c == eof ? std::ios::eofbit | std::ios::failbit : std::ios::failbit);
+                return;
+            }
+            unsigned v{0};
+            do {
+                v = v * 10 + static_cast<unsigned>(c - '0');
+                if (v > max_val) {
+                    is.setstate(std::ios::failbit);
+                    return;
+                }
+                c = sb->snextc();
+            } while (!one_digit && c != eof && is_plain_digit(c));
+            data[i] = static_cast<T>(v);
+        }
+    }
+
+    // P4 : each row packed 8 pixels per byte, most significant bit first, 1 is black
+
+    inline void write_raster(std::ostream& os, const std::vector<bool>& data, std::size_t width, std::uint16_t, format_tag<Format::BIN>) {
+        if (width == 0) { return; }
+        auto row_bytes = (width + 7) / 8;
+        auto height    = data.size() / width;
+        std::vector<char> buf(row_bytes * height, 0);
+        auto it = data.begin();
+        for (std::size_t row = 0; row < height; row ++) {
+            auto out = reinterpret_cast<unsigned char*>(&buf[row * row_bytes]);
+            for (std::size_t col = 0; col < width; col ++, ++ it) {
+                if (*it) { out[col >> 3] |= static_cast<unsigned char>(0x80u >> (col & 7)); }
+            }
+        }
+        os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    }
+
+    inline void read_raster(std::istream& is, std::vector<bool>& data, std::size_t first, std::size_t width, std::uint16_t, format_tag<Format::BIN>) {
+        if (width == 0) { return; }
+        auto row_bytes = (width + 7) / 8;
+        auto height    = (data.size() - first) / width;
+        std::vector<char> buf(row_bytes * height);
+        if (!is.read(buf.data(), static_cast<std::streamsize>(buf.size()))) { return; }
+        auto it = data.begin() + static_cast<std::ptrdiff_t>(first);
+        for (std::size_t row = 0; row < height; row ++) {
+            auto in = reinterpret_cast<const unsigned char*>(&buf[row * row_bytes]);
+            for (std::size_t col = 0; col < width; col ++, ++ it) {
+                *it = (in[col >> 3] >> (7 - (col & 7))) & 1u;
+            }
+        }
+    }
+
+    // P5, P6 : one byte per sample, two bytes (big endian) when max value > 255
+
+    inline void write_raster(std::ostream& os, const std::vector<std::uint16_t>& data, std::size_t, std::uint16_t max_val, format_tag<Format::BIN>) {
+        auto wide = max_val > UINT8_MAX;
+        std::vector<unsigned char> buf(data.size() * (wide ? 2 : 1));
+        if (wide) {
+            for (std::size_t i = 0; i < data.size(); i ++) {
+                buf[2 * i]     = static_cast<unsigned char>(data[i] >> 8);
+                buf[2 * i + 1] = static_cast<unsigned char>(data[i]);
+            }
+        }
+        else {
+            std::transform(data.begin(), data.end(), buf.begin(), [](std::uint16_t v) { return static_cast<unsigned char>(v); });
+        }
+        os.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+    }
+
+    inline void read_raster(std::istream& is, std::vector<std::uint16_t>& data, std::size_t first, std::size_t, std::uint16_t max_val, format_tag<Format::BIN>) {
+        auto wide  = max_val > UINT8_MAX;
+        auto count = data.size() - first;
+        std::vector<unsigned char> buf(count * (wide ? 2 : 1));
+        if (!is.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(buf.size()))) { return; }
+        auto out = data.data() + first;
+        unsigned top{0};
+        if (wide) {
+            for (std::size_t i = 0; i < count; i ++) {
+                out[i] = static_cast<std::uint16_t>(buf[2 * i] << 8 | buf[2 * i + 1]);
+                top = std::max<unsigned>(top, out[i]);
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < count; i ++) {
+                out[i] = buf[i];
+                top = std::max<unsigned>(top, buf[i]);
+            }
+        }
+        if (top > max_val) { is.setstate(std::ios::failbit); }
+    }
+
+    // Plain (ASCII) and raw (BIN) PBM/PGM/PPM, comments are skipped when reading
     template<Anymap P, Format F = Format::ASCII>
     class Image {
     public:
@@ -88,15 +274,15 @@ namespace impl_pixmap_ {
         using const_iterator = typename data_storage::const_iterator;
         using pixel = std::conditional_t < P == Anymap::PPM, std::array<value_type, 3>, reference> ;
 
-        Image() = default;
+        Image() : Image(0) {}
         explicit Image(size_type size) : Image(size, size) {}
-        Image(size_type width, size_type height) : Image(data_storage(width * height * (P==Anymap::PPM ? 3 : 1)), width, height) {}
+        Image(size_type width, size_type height) : Image(data_storage(width * height * samples_per_pixel(P)), width, height) {}
         Image(const data_storage& data, size_type size) : Image(data, size, size) {} // use delegate constructor
         Image(const data_storage& data, size_type width, size_type height, value_type max_val = UINT8_MAX) // 255
             : magic_number_(std::string{ "P" + std::to_string(map_magic_num[{P, F}]) })
             , width_{ width }
             , height_{ height }
-            , max_val_{ max_val }
+            , max_val_{ P == Anymap::PBM ? std::uint16_t{1} : static_cast<std::uint16_t>(max_val) }
             , data_(data)
         {}
 
@@ -143,11 +329,14 @@ namespace impl_pixmap_ {
 
         void fill(data_storage& data) { std::copy(data.begin(), data.end(), data_.begin()); }
 
+        std::uint16_t max_val() const { return max_val_; }
+
         void save(const std::string& filename) {
             std::ofstream ofs;
-            ofs.open(filename, std::ios::out);
+            ofs.open(filename, std::ios::out | std::ios::binary);
             ofs << (*this);
             ofs.close();
+            if (!ofs) { throw std::ios_base::failure("pixmap: cannot write " + filename); }
         }
 
         pointer data() { return data_.data(); }
@@ -166,21 +355,57 @@ namespace impl_pixmap_ {
     template <Anymap P, Format F>
     void load(const std::string& filename, Image<P, F>& img) {
         std::ifstream ifs;
-        ifs.open(filename, std::ios::in);
+        ifs.open(filename, std::ios::in | std::ios::binary);
         ifs >> img;
-        ifs.close();
+        if (!ifs) { throw std::ios_base::failure("pixmap: cannot read " + filename); }
     }
     
+    //! Header then the raster in one write (BIN) or as text (ASCII)
     template<Anymap P, Format F>
     std::ostream& operator<<(std::ostream& os, const Image<P, F>& img) {
-        return  os << img.magic_number_ << "\n"
-            << img.width_ << " " << img.height_ << "\n"
-            << img.max_val_ << "\n" << img.data_;
+        os << img.magic_number_ << "\n" << img.width_ << " " << img.height_ << "\n";
+        if (P != Anymap::PBM) { os << img.max_val_ << "\n"; }
+        write_raster(os, img.data_, img.width_ * samples_per_pixel(P), img.max_val_, format_tag<F>{});
+        return os;
     }
 
+    // samples read per chunk (at least one row) : the raster grows as data arrives, a header
+    // announcing more than the stream holds fails without allocating it
+    constexpr std::size_t raster_chunk = std::size_t{1} << 15;
+
+    //! Sets failbit when the magic number does not match the image type, the size is
+    //! out of bounds, a sample is above max value or the data is short
     template<Anymap P, Format F>
     std::istream& operator>>(std::istream& is, Image<P, F>& img) {
-        return is >> img.magic_number_ >> img.width_ >> img.height_ >> img.max_val_ >> img.data_;
+        std::string magic_number;
+        std::size_t width{0}, height{0}, max_val{1};
+        if (!read_magic_number(is, P, F, magic_number) || !read_header_value(is, width) || !read_header_value(is, height)
+            || (P != Anymap::PBM && !read_header_value(is, max_val))) {
+            is.setstate(std::ios::failbit);
+            return is;
+        }
+        if (max_val == 0 || max_val > UINT16_MAX || width > max_dimension || height > max_dimension) {
+            is.setstate(std::ios::failbit);
+            return is;
+        }
+        is.get(); // single whitespace ending the header
+        auto row_samples = width * samples_per_pixel(P);
+        auto total = row_samples * height;
+        auto chunk = row_samples * std::max<std::size_t>(1, raster_chunk / std::max<std::size_t>(1, row_samples));
+        typename Image<P, F>::data_storage data;
+        data.reserve(std::min(total, raster_chunk * 64));
+        while (data.size() < total) {
+            auto first = data.size();
+            data.resize(first + std::min(chunk, total - first));
+            read_raster(is, data, first, row_samples, static_cast<std::uint16_t>(max_val), format_tag<F>{});
+            if (!is) { return is; }
+        }
+        img.magic_number_ = magic_number;
+        img.width_        = width;
+        img.height_       = height;
+        img.max_val_      = static_cast<std::uint16_t>(max_val);
+        img.data_         = std::move(data);
+        return is;
     }
 
     template <Anymap P, Format F>
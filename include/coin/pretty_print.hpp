@@ -1,7 +1,16 @@
 #pragma once
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <ostream>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <type_traits>
 
 #include <map>
@@ -23,7 +32,7 @@ template<typename T, typename = void>
 struct has_to_string : std::false_type { };
 
 template<typename T>
-struct has_to_string<T, 
+struct has_to_string<T,
     void_t<decltype(std::declval<T>().to_string())>
     >
     : std::true_type { };
@@ -35,113 +44,569 @@ operator<<(std::ostream& os, const T& t) {
 }
 
 
-// for std::pair
+// output : the printers append to a sink, a caller owned std::string or a stream
+// through a fixed buffer, no temporary string is built per element
+
+class StringSink {
+public:
+    explicit StringSink(std::string& out) : out_(out) {}
+
+    void write(const char* s, std::size_t n) { out_.append(s, n); }
+    void put(char c) { out_.push_back(c); }
+
+private:
+    std::string& out_;
+};
+
+class StreamSink {
+public:
+    explicit StreamSink(std::ostream& os) : os_(os) {}
+    ~StreamSink() { flush(); }
+
+    StreamSink(const StreamSink&)            = delete;
+    StreamSink& operator=(const StreamSink&) = delete;
+
+    void write(const char* s, std::size_t n) {
+        if (used_ + n > k_size) {
+            flush();
+            if (n > k_size) {
+                os_.write(s, static_cast<std::streamsize>(n));
+                return;
+            }
+        }
+        std::memcpy(buf_ + used_, s, n);
+        used_ += n;
+    }
+
+    void put(char c) {
+        if (used_ == k_size) { flush(); }
+        buf_[used_ ++] = c;
+    }
+
+    void flush() {
+        os_.write(buf_, static_cast<std::streamsize>(used_));
+        used_ = 0;
+    }
+
+private:
+    static constexpr std::size_t k_size = 4096;
+
+    std::ostream& os_;
+    std::size_t   used_{0};
+    char          buf_[k_size];
+};
+
+
+// numbers, same text as std::to_string : integers by pairs of digits, floating points with "%f"
+
+inline const char* digit_pairs() {
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    return pairs;
+}
+
+template<typename U>
+char* format_unsigned(char* end, U v) {
+    while (v >= 100) {
+        auto i = static_cast<std::size_t>(v % 100) * 2;
+        v /= 100;
+        end -= 2;
+        std::memcpy(end, digit_pairs() + i, 2);
+    }
+    if (v >= 10) {
+        end -= 2;
+        std::memcpy(end, digit_pairs() + static_cast<std::size_t>(v) * 2, 2);
+    }
+    else {
+        *-- end = static_cast<char>('0' + v);
+    }
+    return end;
+}
+
+template<typename Sink, typename T>
+void write_integer(Sink& sink, T v, std::true_type /*signed*/) {
+    using U = std::make_unsigned_t<T>;
+    char buf[std::numeric_limits<U>::digits10 + 3];
+    auto end = buf + sizeof(buf);
+    auto u = static_cast<U>(v);
+    auto p = format_unsigned(end, v < 0 ? static_cast<U>(U(0) - u) : u);
+    if (v < 0) { *-- p = '-'; }
+    sink.write(p, static_cast<std::size_t>(end - p));
+}
+
+template<typename Sink, typename T>
+void write_integer(Sink& sink, T v, std::false_type /*signed*/) {
+    char buf[std::numeric_limits<T>::digits10 + 2];
+    auto end = buf + sizeof(buf);
+    auto p = format_unsigned(end, v);
+    sink.write(p, static_cast<std::size_t>(end - p));
+}
+
+template<typename Sink, typename T>
+void write_number(Sink& sink, T v, std::true_type /*integral*/) {
+    write_integer(sink, v, std::is_signed<T>{});
+}
+
+template<typename Sink>
+void write_number(Sink& sink, bool v, std::true_type /*integral*/) {
+    sink.put(v ? '1' : '0');
+}
+
+//! "%f" of a finite double below 2^63 in integer arithmetic, false when out of this domain.
+//! v = mant * 2^e exactly, the 6 decimals are round(frac * 10^6) with ties to even as printf.
+template<typename Sink>
+bool write_fixed(Sink& sink, double v) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    if (!(std::fabs(v) < 9.2e18)) { return false; } // NaN too
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    auto exp  = static_cast<int>((bits >> 52) & 0x7ff);
+    auto mant = bits & ((std::uint64_t{1} << 52) - 1);
+    if (exp) { mant |= std::uint64_t{1} << 52; } else { exp = 1; }
+    auto e = exp - 1075;
+    std::uint64_t ip = 0, q = 0;
+    if (e >= 0) {
+        ip = mant << e;
+    }
+    else if (e > -128) {
+        auto k    = -e;
+        auto mask = (u128{1} << k) - 1;
+        ip = k < 64 ? mant >> k : 0;
+        auto r    = (u128{mant} & mask) * 1000000u;
+        q = static_cast<std::uint64_t>(r >> k);
+        auto rem  = r & mask;
+        auto half = u128{1} << (k - 1);
+        if (rem > half || (rem == half && (q & 1))) { ++ q; }
+        if (q == 1000000) { q = 0; ++ ip; }
+    }
+    char buf[32];
+    auto end = buf + sizeof(buf);
+    auto p = end - 6;
+    for (auto d = end; d != p; q /= 10) { *-- d = static_cast<char>('0' + q % 10); }
+    *-- p = '.';
+    p = format_unsigned(p, ip);
+    if (bits >> 63) { *-- p = '-'; }
+    sink.write(p, static_cast<std::size_t>(end - p));
+    return true;
+#else
+    (void)sink;
+    (void)v;
+    return false;
+#endif
+}
+
+template<typename Sink, typename T>
+void write_number(Sink& sink, T v, std::false_type /*integral*/) {
+    if (!std::is_same<T, long double>::value && write_fixed(sink, static_cast<double>(v))) {
+        return;
+    }
+    // "%f" of the largest value has max_exponent10 + 1 integral digits
+    char buf[std::numeric_limits<T>::max_exponent10 + 32];
+    auto n = std::is_same<T, long double>::value
+        ? std::snprintf(buf, sizeof(buf), "%Lf", static_cast<long double>(v))
+        : std::snprintf(buf, sizeof(buf), "%f", static_cast<double>(v));
+    sink.write(buf, static_cast<std::size_t>(n));
+}
+
+
+// for std::pair and std::tuple
 
 template<class U> struct is_pair : public std::false_type {};
 
 template<class U, class V> struct is_pair<std::pair<U,V>> : public std::true_type {};
 
-template<typename U, typename V>
-std::string to_string(const std::pair<U,V>& p); // must declare it because of (1)
+template<class U> struct is_tuple : public std::false_type {};
 
-template<typename T> std::enable_if_t<!is_pair<T>::value, std::string>
-stringify_bis(const T& t) { return t; }
+template<class... Ts> struct is_tuple<std::tuple<Ts...>> : public std::true_type {};
 
-template<typename T> std::enable_if_t<is_pair<T>::value, std::string>
-stringify_bis(const T& t) { return to_string(t); } // (1)
 
-template<typename T> std::enable_if_t<!std::is_fundamental<T>::value, std::string>
-stringify(const T& t) { return stringify_bis(t); }
+// for nested containers : anything with begin/end and a value_type, except strings and
+// the classes printing themselves with to_string()
 
-template<typename T> std::enable_if_t<std::is_fundamental<T>::value, std::string>
-stringify(const T& t) { return std::to_string(t); }
+template<class T> struct is_string : public std::false_type {};
 
-template<typename U, typename V>
-std::string to_string(const std::pair<U,V>& p) {
-    using std::to_string;
-    return std::string{"{" + stringify(p.first) + ":" + stringify(p.second) + "}"};
+template<class C, class Traits, class Alloc>
+struct is_string<std::basic_string<C, Traits, Alloc>> : public std::true_type {};
+
+template<typename T, typename = void>
+struct is_iterable : std::false_type { };
+
+template<typename T>
+struct is_iterable<T,
+    void_t<typename T::value_type,
+           decltype(std::begin(std::declval<const T&>())),
+           decltype(std::end(std::declval<const T&>()))>
+    >
+    : std::true_type { };
+
+template<class T>
+struct is_container : public std::integral_constant<bool,
+    is_iterable<T>::value && !is_string<T>::value && !has_to_string<T>::value> {};
+
+//! Contiguous numbers (vector, array, ColumnView...) : formatted in bulk
+template<typename T, typename = void>
+struct is_number_block : std::false_type { };
+
+template<typename T>
+struct is_number_block<T,
+    void_t<decltype(std::declval<const T&>().data()), decltype(std::declval<const T&>().size())>
+    >
+    : std::integral_constant<bool,
+        std::is_arithmetic<typename T::value_type>::value && !std::is_same<typename T::value_type, bool>::value
+        && std::is_convertible<decltype(std::declval<const T&>().data()), const typename T::value_type*>::value> { };
+
+
+// limits of one printing : safe to log containers of any size
+
+struct PrintOptions {
+    static constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+    std::size_t max_elements{unlimited}; // per container, then ",... N more"
+    std::size_t max_depth{unlimited};    // nesting levels printed, deeper containers are [...]
+    std::size_t max_bytes{unlimited};    // output budget, the text is cut before the token which would exceed it and ends with "..."
+};
+
+//! Options used by coin::operator<< (unlimited by default), to be set at startup
+inline PrintOptions& default_print_options() {
+    static PrintOptions options;
+    return options;
 }
 
+//! Sink wrapper applying PrintOptions : counts the bytes written and the nesting depth
+template<typename Sink>
+class Printer {
+public:
+    Printer(Sink& sink, const PrintOptions& options) : sink_(sink), options_(options) {}
+
+    void write(const char* s, std::size_t n) {
+        if (stopped_) { return; }
+        if (n > options_.max_bytes - bytes_) {
+            stop();
+            return;
+        }
+        bytes_ += n;
+        sink_.write(s, n);
+    }
 
-// for nested containers
+    void put(char c) { write(&c, 1); }
 
-template<class T> struct is_container : public std::false_type {};
+    bool stopped() const { return stopped_; }
+    const PrintOptions& options() const { return options_; }
 
-template<class T, class Alloc> 
-struct is_container<std::vector<T, Alloc>> : public std::true_type {};
+    //! false when the container is too deep to be printed
+    bool enter() { return depth_ ++ < options_.max_depth; }
+    void leave() { -- depth_; }
 
-template<class K, class T, class Comp, class Alloc> 
-struct is_container<std::map<K, T, Comp, Alloc>> : public std::true_type {};
+private:
+    void stop() {
+        stopped_ = true;
+        sink_.write("...", 3);
+    }
 
-template<class K, class T, class Comp, class Alloc> 
-struct is_container<std::unordered_map<K, T, Comp, Alloc>> : public std::true_type {};
+    Sink&        sink_;
+    PrintOptions options_;
+    std::size_t  bytes_{0};
+    std::size_t  depth_{0};
+    bool         stopped_{false};
+};
 
-// element type
-template <typename Cont, std::enable_if_t<!is_container<typename Cont::value_type>::value>* = nullptr>
-std::string to_string(Cont const& container) {
-    using std::to_string;
-    using std::begin;
+
+// dispatch of one printed value
+
+enum class kind { number, self, pair, tuple, container, text };
+
+template<typename T>
+using kind_of = std::integral_constant<kind,
+    std::is_arithmetic<T>::value ? kind::number
+    : has_to_string<T>::value    ? kind::self
+    : is_pair<T>::value          ? kind::pair
+    : is_tuple<T>::value         ? kind::tuple
+    : is_container<T>::value     ? kind::container
+    :                              kind::text>;
+
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t);
+
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t, std::integral_constant<kind, kind::number>) {
+    write_number(sink, t, std::is_integral<T>{});
+}
+
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t, std::integral_constant<kind, kind::pair>) {
+    sink.put('{');
+    write_value(sink, t.first);
+    sink.put(':');
+    write_value(sink, t.second);
+    sink.put('}');
+}
+
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t, std::integral_constant<kind, kind::self>) {
+    auto s = t.to_string();
+    sink.write(s.data(), s.size());
+}
+
+template<typename Sink, typename Tuple, std::size_t... I>
+void write_tuple(Sink& sink, const Tuple& t, std::index_sequence<I...>) {
+    sink.put('{');
+    int expand[] = {0, ((I ? sink.put(':') : (void)0), write_value(sink, std::get<I>(t)), 0)...};
+    (void)expand;
+    (void)t;
+    sink.put('}');
+}
+
+//! Tuples as pairs : {a:b:c}
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t, std::integral_constant<kind, kind::tuple>) {
+    write_tuple(sink, t, std::make_index_sequence<std::tuple_size<T>::value>{});
+}
+
+template<typename Sink>
+void write_text(Sink& sink, const std::string& s) { sink.write(s.data(), s.size()); }
+
+template<typename Sink>
+void write_text(Sink& sink, const char* s) { sink.write(s, std::strlen(s)); }
+
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t, std::integral_constant<kind, kind::text>) {
+    write_text(sink, t);
+}
+
+template<typename T, typename = void>
+struct has_size : std::false_type {};
+
+template<typename T>
+struct has_size<T, void_t<decltype(std::declval<const T&>().size())>> : std::true_type {};
+
+template<typename Cont, typename It>
+std::size_t remaining(const Cont& container, It, std::size_t printed, std::true_type /*size*/) {
+    return static_cast<std::size_t>(container.size()) - printed;
+}
+
+template<typename Cont, typename It>
+std::size_t remaining(const Cont& container, It it, std::size_t, std::false_type /*size*/) {
     using std::end;
-    std::string str = "[";
-    for (auto &&it = begin(container); it != container.end(); ++it) {
-        str += stringify(*it) + ",";
-    }
-    str.pop_back();
-    str += "]";
+    return static_cast<std::size_t>(std::distance(it, end(container)));
+}
 
-    return str;
+template<typename Sink>
+void write_more(Printer<Sink>& out, std::size_t more) {
+    char buf[24];
+    auto end = buf + sizeof(buf);
+    auto p = format_unsigned(end, more);
+    out.write("... ", 4);
+    out.write(p, static_cast<std::size_t>(end - p));
+    out.write(" more", 5);
 }
 
-template <typename Cont, std::enable_if_t<is_container<typename Cont::value_type>::value>* = nullptr>
-std::string to_string(Cont const& container) {
+template<typename Sink, typename Cont>
+void write_elements(Printer<Sink>& out, const Cont& container, std::false_type /*number block*/) {
     using std::begin;
     using std::end;
-    std::string str = "{"; 
-    for (auto &&it = begin(container); it != container.end(); ++it) {
-        str += to_string(*it) + ",";
+    std::size_t count = 0;
+    for (auto it = begin(container); it != end(container) && !out.stopped(); ++ it, ++ count) {
+        if (count) { out.put(','); }
+        if (count == out.options().max_elements) {
+            write_more(out, remaining(container, it, count, has_size<Cont>{}));
+            break;
+        }
+        write_value(out, *it);
     }
-    str.pop_back();
-    str += "}";
+}
+
+//! Fixed buffer collecting the numbers of a block, handed to the printer 4 KB at a time
+template<typename Sink>
+class ChunkSink {
+public:
+    explicit ChunkSink(Printer<Sink>& out) : out_(out) {}
+    ~ChunkSink() { flush(); }
+
+    ChunkSink(const ChunkSink&)            = delete;
+    ChunkSink& operator=(const ChunkSink&) = delete;
+
+    void write(const char* s, std::size_t n) {
+        if (used_ + n > k_size) { flush(); }
+        std::memcpy(buf_ + used_, s, n);
+        used_ += n;
+    }
+    void put(char c) {
+        if (used_ == k_size) { flush(); }
+        buf_[used_ ++] = c;
+    }
+    void flush() {
+        if (used_ == 0) { return; }
+        out_.write(buf_, used_);
+        used_ = 0;
+    }
+
+private:
+    // larger than any formatted number but long double
+    static constexpr std::size_t k_size = 4096;
+
+    Printer<Sink>& out_;
+    std::size_t    used_{0};
+    char           buf_[k_size];
+};
+
+template<typename Sink, typename Cont>
+void write_elements(Printer<Sink>& out, const Cont& container, std::true_type /*number block*/) {
+    using value_type = typename Cont::value_type;
+    if (out.options().max_bytes != PrintOptions::unlimited || std::is_same<value_type, long double>::value) {
+        // the byte budget is checked number by number
+        write_elements(out, container, std::false_type{});
+        return;
+    }
+    auto data  = container.data();
+    auto size  = static_cast<std::size_t>(container.size());
+    auto shown = std::min(size, out.options().max_elements);
+    {
+        ChunkSink<Sink> chunk{out};
+        for (std::size_t i = 0; i < shown; i ++) {
+            if (i) { chunk.put(','); }
+            write_number(chunk, data[i], std::is_integral<value_type>{});
+        }
+    }
+    if (shown < size) {
+        if (shown) { out.put(','); }
+        write_more(out, size - shown);
+    }
+}
+
+//! Elements between brackets, or between braces when they are containers themselves
+template<typename Sink, typename Cont>
+void write_container(Printer<Sink>& out, const Cont& container) {
+    auto nested = is_container<typename Cont::value_type>::value;
+    out.put(nested ? '{' : '[');
+    if (!out.enter()) {
+        out.write("...", 3);
+    }
+    else {
+        write_elements(out, container, is_number_block<Cont>{});
+    }
+    out.leave();
+    out.put(nested ? '}' : ']');
+}
+
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t, std::integral_constant<kind, kind::container>) {
+    write_container(sink, t);
+}
+
+template<typename Sink, typename T>
+void write_value(Sink& sink, const T& t) {
+    write_value(sink, t, kind_of<T>{});
+}
+
+template<typename Sink, typename T>
+void print_value(Sink& sink, const T& t, const PrintOptions& options) {
+    Printer<Sink> out{sink, options};
+    write_value(out, t);
+}
+
+template<typename Sink, class T, std::size_t N>
+void print_value(Sink& sink, const std::array<T, N>& arr, const PrintOptions& options) {
+    Printer<Sink> out{sink, options};
+    write_container(out, arr);
+}
+
+
+template<typename U, typename V>
+std::string to_string(const std::pair<U,V>& p) {
+    std::string str;
+    StringSink sink{str};
+    print_value(sink, p, PrintOptions{});
+    return str;
+}
+
+template <typename Cont, typename = typename Cont::value_type>
+std::string to_string(Cont const& container, const PrintOptions& options = PrintOptions{}) {
+    std::string str;
+    StringSink sink{str};
+    Printer<StringSink> out{sink, options};
+    write_container(out, container);
     return str;
 }
 
+//! Append the printed container (or pair, number, string) to out, which the caller may reuse
+template<typename T>
+void print_to(std::string& out, const T& t, const PrintOptions& options = PrintOptions{}) {
+    StringSink sink{out};
+    print_value(sink, t, options);
+}
+
+//! Stream the printed value : memory use does not depend on the size of the container
+template<typename T>
+void print_to(std::ostream& os, const T& t, const PrintOptions& options = PrintOptions{}) {
+    StreamSink sink{os};
+    print_value(sink, t, options);
+}
+
+//! Value printed with given limits by operator<< : os << coin::printed(v, {1000, 3, 1 << 20})
+template<typename T>
+struct Printed {
+    const T&     value;
+    PrintOptions options;
+};
+
+template<typename T>
+Printed<T> printed(const T& t, const PrintOptions& options) { return {t, options}; }
+
+template<typename T>
+std::ostream& operator<<(std::ostream& os, const Printed<T>& p) {
+    print_to(os, p.value, p.options);
+    return os;
+}
+
 
 // magic operates : overload ostream operator<< !
 
-template<class T, class Alloc> 
+template<class T, class Alloc>
 std::ostream& operator<<(std::ostream& os, const std::vector<T, Alloc>& v) {
-    using std::operator<<;
-    os << to_string(v);
+    print_to(os, v, default_print_options());
     return os;
 }
 
 
-template<class T, std::size_t N> 
+template<class T, std::size_t N>
 std::ostream& operator<<(std::ostream& os, const std::array<T, N>& arr) {
-    using std::operator<<;
-    os << to_string(arr);
+    print_to(os, arr, default_print_options());
     return os;
 }
 
 
-template<class Key, class T, class Comp, class Alloc> 
+template<class Key, class T, class Comp, class Alloc>
 std::ostream& operator<<(std::ostream& os, const std::map<Key,T,Comp,Alloc>& m) {
-    using std::operator<<;
-    os << to_string(m);
+    print_to(os, m, default_print_options());
     return os;
 }
 
-template<class Key, class T, class Comp, class Alloc> 
+template<class Key, class T, class Comp, class Alloc>
 std::ostream& operator<<(std::ostream& os, const std::unordered_map<Key,T,Comp,Alloc>& m) {
-    using std::operator<<;
-    os << to_string(m);
+    print_to(os, m, default_print_options());
     return os;
 }
 
 template<typename U, typename V>
 std::ostream& operator<<(std::ostream& os, const std::pair<U,V>& p) {
-    using std::operator<<;
-    os << to_string(p);
+    print_to(os, p, default_print_options());
+    return os;
+}
+
+template<typename... Ts>
+std::ostream& operator<<(std::ostream& os, const std::tuple<Ts...>& t) {
+    print_to(os, t, default_print_options());
+    return os;
+}
+
+//! Any other container : set, deque, list, flat_map, ColumnView...
+template<typename Cont>
+std::enable_if_t<is_container<Cont>::value, std::ostream&>
+operator<<(std::ostream& os, const Cont& container) {
+    print_to(os, container, default_print_options());
     return os;
 }
 
@@ -194,6 +659,9 @@ inline std::ostream& operator<<(std::ostream& os, const std::error_code& ec) {
 using _impl_stringify::to_string; // for container
 using _impl_stringify::operator<<;
 using _impl_stringify::stream_to_string;
+using _impl_stringify::print_to;
+using _impl_stringify::PrintOptions;
+using _impl_stringify::default_print_options;
+using _impl_stringify::printed;
 
 } // namespace coin
-
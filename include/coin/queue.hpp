@@ -0,0 +1,341 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "semaphore.hpp"
+
+namespace coin {
+
+namespace _impl_queue {
+
+constexpr std::size_t k_cache_line = 64;
+
+inline std::size_t round_capacity(std::size_t n) {
+    std::size_t c = 2;
+    while (c < n) { c <<= 1; }
+    return c;
+}
+
+// index followed by a whole cache line (padding instead of alignas : C++14 new ignores extended
+// alignment), so two padded values never share a line whatever the address of the queue.
+// The first padded member of a queue is preceded by a pad_ line for the same reason.
+template<typename T>
+struct Padded {
+    T value;
+    char pad[k_cache_line];
+};
+
+
+//! Lamport single producer / single consumer bounded ring.
+//! Each side caches the other side's index so it only touches the shared cache
+//! line when the ring looks full (producer) or empty (consumer).
+template<typename T>
+class spsc_queue {
+public:
+    using value_type = T;
+
+    explicit spsc_queue(std::size_t capacity)
+        : mask_{round_capacity(capacity + 1) - 1}
+        , slots_{new Slot[mask_ + 1]} {}
+
+    ~spsc_queue() {
+        auto tail = tail_.value.load(std::memory_order_relaxed);
+        for (auto i = head_.value.load(std::memory_order_relaxed); i != tail; i = (i + 1) & mask_) {
+            slot(i)->~T();
+        }
+    }
+
+    spsc_queue(const spsc_queue&)            = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    std::size_t capacity() const { return mask_; }
+
+    template<typename... Args>
+    bool try_emplace(Args&&... args) {
+        auto tail = tail_.value.load(std::memory_order_relaxed);
+        auto next = (tail + 1) & mask_;
+        if (next == head_cache_.value) {
+            head_cache_.value = head_.value.load(std::memory_order_acquire);
+            if (next == head_cache_.value) { return false; }
+        }
+        new (slot(tail)) T(std::forward<Args>(args)...);
+        tail_.value.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& v) { return try_emplace(v); }
+    bool try_push(T&& v)      { return try_emplace(std::move(v)); }
+
+    bool try_pop(T& out) {
+        auto head = head_.value.load(std::memory_order_relaxed);
+        if (head == tail_cache_.value) {
+            tail_cache_.value = tail_.value.load(std::memory_order_acquire);
+            if (head == tail_cache_.value) { return false; }
+        }
+        T* p = slot(head);
+        out = std::move(*p);
+        p->~T();
+        head_.value.store((head + 1) & mask_, std::memory_order_release);
+        return true;
+    }
+
+    //! Push up to n items with a single index publication, return how many were pushed
+    template<typename InputIt>
+    std::size_t try_push_n(InputIt first, std::size_t n) {
+        auto tail = tail_.value.load(std::memory_order_relaxed);
+        auto free_slots = (head_cache_.value - tail - 1) & mask_;
+        if (free_slots < n) {
+            head_cache_.value = head_.value.load(std::memory_order_acquire);
+            free_slots = (head_cache_.value - tail - 1) & mask_;
+        }
+        if (n > free_slots) { n = free_slots; }
+        for (std::size_t i = 0; i < n; i ++, ++ first) {
+            new (slot((tail + i) & mask_)) T(*first);
+        }
+        tail_.value.store((tail + n) & mask_, std::memory_order_release);
+        return n;
+    }
+
+    //! Pop up to n items into out with a single index publication, return how many were popped
+    template<typename OutputIt>
+    std::size_t try_pop_n(OutputIt out, std::size_t n) {
+        auto head = head_.value.load(std::memory_order_relaxed);
+        auto available = (tail_cache_.value - head) & mask_;
+        if (available < n) {
+            tail_cache_.value = tail_.value.load(std::memory_order_acquire);
+            available = (tail_cache_.value - head) & mask_;
+        }
+        if (n > available) { n = available; }
+        for (std::size_t i = 0; i < n; i ++) {
+            T* p = slot((head + i) & mask_);
+            *out++ = std::move(*p);
+            p->~T();
+        }
+        head_.value.store((head + n) & mask_, std::memory_order_release);
+        return n;
+    }
+
+    std::size_t size_approx() const {
+        return (tail_.value.load(std::memory_order_relaxed) - head_.value.load(std::memory_order_relaxed)) & mask_;
+    }
+    bool empty() const { return size_approx() == 0; }
+
+private:
+    using Slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+    T* slot(std::size_t i) { return reinterpret_cast<T*>(&slots_[i]); }
+
+    std::size_t                       mask_;                 // read by both sides
+    std::unique_ptr<Slot[]>           slots_;
+    char                              pad_[k_cache_line];
+    Padded<std::atomic<std::size_t>>  head_{{0}, {}};        // written by the consumer
+    Padded<std::size_t>               tail_cache_{0, {}};    // consumer's copy of tail
+    Padded<std::atomic<std::size_t>>  tail_{{0}, {}};        // written by the producer
+    Padded<std::size_t>               head_cache_{0, {}};    // producer's copy of head
+};
+
+
+//! Dmitry Vyukov's bounded multi producer / multi consumer queue : every cell carries
+//! a sequence number telling whether it is ready to be written or read for a given lap,
+//! so producers and consumers only contend on their own position counter.
+template<typename T>
+class mpmc_queue {
+public:
+    using value_type = T;
+
+    explicit mpmc_queue(std::size_t capacity)
+        : mask_{round_capacity(capacity) - 1}
+        , cells_{new Cell[mask_ + 1]} {
+        for (std::size_t i = 0; i <= mask_; i ++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~mpmc_queue() {
+        auto end = enqueue_pos_.value.load(std::memory_order_relaxed);
+        for (auto pos = dequeue_pos_.value.load(std::memory_order_relaxed); pos != end; ++ pos) {
+            cells_[pos & mask_].get()->~T();
+        }
+    }
+
+    mpmc_queue(const mpmc_queue&)            = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    template<typename... Args>
+    bool try_emplace(Args&&... args) {
+        Cell* cell;
+        auto pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            auto seq = cell->sequence.load(std::memory_order_acquire);
+            auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (dif == 0) {
+                if (enqueue_pos_.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (dif < 0) {
+                return false; // full
+            }
+            else {
+                pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->get()) T(std::forward<Args>(args)...);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& v) { return try_emplace(v); }
+    bool try_push(T&& v)      { return try_emplace(std::move(v)); }
+
+    bool try_pop(T& out) {
+        Cell* cell;
+        auto pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            auto seq = cell->sequence.load(std::memory_order_acquire);
+            auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (dif == 0) {
+                if (dequeue_pos_.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (dif < 0) {
+                return false; // empty
+            }
+            else {
+                pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+            }
+        }
+        T* p = cell->get();
+        out = std::move(*p);
+        p->~T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename InputIt>
+    std::size_t try_push_n(InputIt first, std::size_t n) {
+        std::size_t k = 0;
+        for (; k < n && try_push(*first); k ++, ++ first) {}
+        return k;
+    }
+
+    template<typename OutputIt>
+    std::size_t try_pop_n(OutputIt out, std::size_t n) {
+        std::size_t k = 0;
+        T tmp;
+        for (; k < n && try_pop(tmp); k ++) { *out++ = std::move(tmp); }
+        return k;
+    }
+
+    std::size_t size_approx() const {
+        auto e = enqueue_pos_.value.load(std::memory_order_relaxed);
+        auto d = dequeue_pos_.value.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+    bool empty() const { return size_approx() == 0; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+        T* get() { return reinterpret_cast<T*>(&storage); }
+    };
+
+    std::size_t                      mask_;                 // read by both sides
+    std::unique_ptr<Cell[]>          cells_;
+    char                             pad_[k_cache_line];
+    Padded<std::atomic<std::size_t>> enqueue_pos_{{0}, {}};
+    Padded<std::atomic<std::size_t>> dequeue_pos_{{0}, {}};
+};
+
+
+//! Blocking push/pop on top of a lock-free bounded queue : two lightweight_semaphore
+//! count the free slots and the available items, threads only sleep on a futex when
+//! the queue is really full or empty.
+template<typename Queue>
+class blocking_queue {
+public:
+    using value_type = typename Queue::value_type;
+
+    explicit blocking_queue(std::size_t capacity)
+        : queue_(capacity)
+        , slots_(queue_.capacity()) {}
+
+    void push(value_type v) {
+        slots_.wait();
+        while (!queue_.try_push(std::move(v))) { _impl_semaphore::cpu_relax(); }
+        items_.notify();
+    }
+
+    bool try_push(value_type v) {
+        if (!slots_.try_wait()) { return false; }
+        while (!queue_.try_push(std::move(v))) { _impl_semaphore::cpu_relax(); }
+        items_.notify();
+        return true;
+    }
+
+    void pop(value_type& out) {
+        items_.wait();
+        take(out);
+    }
+
+    bool try_pop(value_type& out) {
+        if (!items_.try_wait()) { return false; }
+        take(out);
+        return true;
+    }
+
+    template<class Rep, class Period>
+    bool pop_for(value_type& out, const std::chrono::duration<Rep, Period>& d) {
+        if (!items_.wait_for(d)) { return false; }
+        take(out);
+        return true;
+    }
+
+    //! Block until at least one item is there, then pop up to n, return how many were popped
+    template<typename OutputIt>
+    std::size_t pop_n(OutputIt out, std::size_t n) {
+        if (n == 0) { return 0; }
+        items_.wait();
+        std::size_t k = 1;
+        while (k < n && items_.try_wait()) { ++ k; }
+        for (std::size_t i = 0; i < k; i ++) {
+            value_type v;
+            take(v);
+            *out++ = std::move(v);
+        }
+        return k;
+    }
+
+    std::size_t size_approx() const { return queue_.size_approx(); }
+
+private:
+    void take(value_type& out) {
+        while (!queue_.try_pop(out)) { _impl_semaphore::cpu_relax(); }
+        slots_.notify();
+    }
+
+    Queue                 queue_;
+    lightweight_semaphore items_{0};
+    lightweight_semaphore slots_;
+};
+
+template<typename T> using blocking_spsc_queue = blocking_queue<spsc_queue<T>>;
+template<typename T> using blocking_mpmc_queue = blocking_queue<mpmc_queue<T>>;
+
+} // ns _impl_queue
+
+using _impl_queue::spsc_queue;
+using _impl_queue::mpmc_queue;
+using _impl_queue::blocking_queue;
+using _impl_queue::blocking_spsc_queue;
+using _impl_queue::blocking_mpmc_queue;
+
+} // ns coin
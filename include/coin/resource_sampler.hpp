@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "knife.hpp"
+#include "thread_guard.hpp"
+
+namespace coin {
+
+namespace _impl_resource {
+
+struct ResourceSample {
+    std::chrono::steady_clock::time_point time;
+    std::uint64_t rss_bytes{0};
+    std::uint64_t peak_rss_bytes{0};
+    std::uint64_t minor_faults{0};
+    std::uint64_t major_faults{0};
+    std::uint64_t voluntary_switches{0};
+    std::uint64_t involuntary_switches{0};
+    std::uint64_t user_cpu_us{0};
+    std::uint64_t system_cpu_us{0};
+    std::uint64_t read_bytes{0};   // storage I/O, 0 when /proc/self/io is not readable
+    std::uint64_t write_bytes{0};
+};
+
+
+//! Background sampler of the process resources.
+//! /proc/self/{statm,status,io} are opened once and re-read with pread into a
+//! fixed buffer and parsed by hand; faults and cpu time come from getrusage.
+//! Last values are published as atomics (readable from any thread without lock)
+//! and the last `capacity` samples are kept in a ring buffer.
+class ResourceSampler {
+public:
+    explicit ResourceSampler(std::chrono::milliseconds interval = std::chrono::milliseconds(100),
+                             std::size_t capacity = 600, bool start_now = true)
+        : interval_{interval}
+        , ring_(capacity ? capacity : 1) {
+        statm_fd_  = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        status_fd_ = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+        io_fd_     = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+        sample_now();
+        if (start_now) { start(); }
+    }
+
+    ~ResourceSampler() {
+        stop();
+        for (int fd : {statm_fd_, status_fd_, io_fd_}) { if (fd >= 0) { close(fd); } }
+    }
+
+    ResourceSampler(const ResourceSampler&)            = delete;
+    ResourceSampler& operator=(const ResourceSampler&) = delete;
+
+    void start() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (thread_) { return; }
+        running_ = true;
+        thread_.reset(new ThreadGuard(std::thread([this] { run(); }), Action::join));
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            running_ = false;
+        }
+        cv_.notify_all();
+        thread_.reset(); // joins
+    }
+
+    //! Take one sample synchronously (also called by the background thread)
+    ResourceSample sample_now() {
+        std::lock_guard<std::mutex> lock{sample_mutex_};
+        ResourceSample s;
+        s.time = std::chrono::steady_clock::now();
+
+        auto len = _detail::pread_file(statm_fd_, buf_, sizeof(buf_));
+        if (len) {
+            const char* p = buf_;
+            _detail::parse_uint(p, buf_ + len); // size
+            s.rss_bytes = _detail::parse_uint(p, buf_ + len) * page_size_;
+        }
+        len = _detail::pread_file(status_fd_, buf_, sizeof(buf_));
+        if (len) {
+            s.peak_rss_bytes       = _detail::parse_proc_field(buf_, len, "VmHWM:") * 1024;
+            s.voluntary_switches   = _detail::parse_proc_field(buf_, len, "\nvoluntary_ctxt_switches:");
+            s.involuntary_switches = _detail::parse_proc_field(buf_, len, "\nnonvoluntary_ctxt_switches:");
+        }
+        len = _detail::pread_file(io_fd_, buf_, sizeof(buf_));
+        if (len) {
+            s.read_bytes  = _detail::parse_proc_field(buf_, len, "\nread_bytes:");
+            s.write_bytes = _detail::parse_proc_field(buf_, len, "\nwrite_bytes:");
+        }
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            s.minor_faults  = static_cast<std::uint64_t>(usage.ru_minflt);
+            s.major_faults  = static_cast<std::uint64_t>(usage.ru_majflt);
+            s.user_cpu_us   = static_cast<std::uint64_t>(usage.ru_utime.tv_sec) * 1000000 + usage.ru_utime.tv_usec;
+            s.system_cpu_us = static_cast<std::uint64_t>(usage.ru_stime.tv_sec) * 1000000 + usage.ru_stime.tv_usec;
+        }
+
+        publish(s);
+        return s;
+    }
+
+    std::uint64_t rss_bytes()            const { return rss_bytes_.load(std::memory_order_relaxed); }
+    std::uint64_t peak_rss_bytes()       const { return peak_rss_bytes_.load(std::memory_order_relaxed); }
+    std::uint64_t minor_faults()         const { return minor_faults_.load(std::memory_order_relaxed); }
+    std::uint64_t major_faults()         const { return major_faults_.load(std::memory_order_relaxed); }
+    std::uint64_t voluntary_switches()   const { return voluntary_switches_.load(std::memory_order_relaxed); }
+    std::uint64_t involuntary_switches() const { return involuntary_switches_.load(std::memory_order_relaxed); }
+    std::uint64_t user_cpu_us()          const { return user_cpu_us_.load(std::memory_order_relaxed); }
+    std::uint64_t system_cpu_us()        const { return system_cpu_us_.load(std::memory_order_relaxed); }
+    std::uint64_t read_bytes()           const { return read_bytes_.load(std::memory_order_relaxed); }
+    std::uint64_t write_bytes()          const { return write_bytes_.load(std::memory_order_relaxed); }
+
+    //! Recorded samples, oldest first
+    std::vector<ResourceSample> history() const {
+        std::lock_guard<std::mutex> lock{ring_mutex_};
+        std::vector<ResourceSample> out;
+        out.reserve(ring_size_);
+        auto first = (ring_head_ + ring_.size() - ring_size_) % ring_.size();
+        for (std::size_t i = 0; i < ring_size_; i ++) {
+            out.push_back(ring_[(first + i) % ring_.size()]);
+        }
+        return out;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (running_) {
+            if (cv_.wait_for(lock, interval_, [this] { return !running_; })) { break; }
+            lock.unlock();
+            sample_now();
+            lock.lock();
+        }
+    }
+
+    void publish(const ResourceSample& s) {
+        rss_bytes_.store(s.rss_bytes, std::memory_order_relaxed);
+        peak_rss_bytes_.store(s.peak_rss_bytes, std::memory_order_relaxed);
+        minor_faults_.store(s.minor_faults, std::memory_order_relaxed);
+        major_faults_.store(s.major_faults, std::memory_order_relaxed);
+        voluntary_switches_.store(s.voluntary_switches, std::memory_order_relaxed);
+        involuntary_switches_.store(s.involuntary_switches, std::memory_order_relaxed);
+        user_cpu_us_.store(s.user_cpu_us, std::memory_order_relaxed);
+        system_cpu_us_.store(s.system_cpu_us, std::memory_order_relaxed);
+        read_bytes_.store(s.read_bytes, std::memory_order_relaxed);
+        write_bytes_.store(s.write_bytes, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock{ring_mutex_};
+        ring_[ring_head_] = s;
+        ring_head_ = (ring_head_ + 1) % ring_.size();
+        if (ring_size_ < ring_.size()) { ++ ring_size_; }
+    }
+
+    std::chrono::milliseconds    interval_;
+    std::uint64_t                page_size_{static_cast<std::uint64_t>(sysconf(_SC_PAGE_SIZE))};
+    int                          statm_fd_{-1};
+    int                          status_fd_{-1};
+    int                          io_fd_{-1};
+    char                         buf_[4096];
+    std::mutex                   sample_mutex_; // protects buf_
+
+    std::atomic<std::uint64_t>   rss_bytes_{0};
+    std::atomic<std::uint64_t>   peak_rss_bytes_{0};
+    std::atomic<std::uint64_t>   minor_faults_{0};
+    std::atomic<std::uint64_t>   major_faults_{0};
+    std::atomic<std::uint64_t>   voluntary_switches_{0};
+    std::atomic<std::uint64_t>   involuntary_switches_{0};
+    std::atomic<std::uint64_t>   user_cpu_us_{0};
+    std::atomic<std::uint64_t>   system_cpu_us_{0};
+    std::atomic<std::uint64_t>   read_bytes_{0};
+    std::atomic<std::uint64_t>   write_bytes_{0};
+
+    mutable std::mutex           ring_mutex_;
+    std::vector<ResourceSample>  ring_;
+    std::size_t                  ring_head_{0};
+    std::size_t                  ring_size_{0};
+
+    std::mutex                   mutex_;
+    std::condition_variable      cv_;
+    bool                         running_{false};
+    std::unique_ptr<ThreadGuard> thread_;
+};
+
+} // ns _impl_resource
+
+using _impl_resource::ResourceSample;
+using _impl_resource::ResourceSampler;
+
+} // ns coin
@@ -0,0 +1,451 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "except.hpp"
+#include "histogram.hpp"
+#include "thread_guard.hpp"
+#include "thread_pool.hpp"
+
+namespace coin {
+
+namespace _impl_retry {
+
+using retry_clock = std::chrono::steady_clock;
+
+//! Token bucket shared by the calls to one dependency : every call deposits `ratio` token,
+//! every retry takes one. When a dependency fails for everybody the retries stop at about
+//! ratio * calls instead of multiplying the load. `reserve` tokens are there at start.
+class RetryBudget {
+public:
+    explicit RetryBudget(double ratio = 0.1, double reserve = 10., double max_tokens = 100.)
+        : ratio_{to_milli(ratio)}
+        , max_{to_milli(max_tokens)}
+        , tokens_{to_milli(reserve)} {}
+
+    void deposit() {
+        auto t = tokens_.load(std::memory_order_relaxed);
+        while (t < max_ && !tokens_.compare_exchange_weak(t, std::min(max_, t + ratio_), std::memory_order_relaxed)) {}
+    }
+
+    bool try_withdraw() {
+        auto t = tokens_.load(std::memory_order_relaxed);
+        while (t >= 1000) {
+            if (tokens_.compare_exchange_weak(t, t - 1000, std::memory_order_relaxed)) { return true; }
+        }
+        return false;
+    }
+
+    double tokens() const { return tokens_.load(std::memory_order_relaxed) / 1000.; }
+
+private:
+    static std::int64_t to_milli(double v) { return static_cast<std::int64_t>(v * 1000.); }
+
+    std::int64_t              ratio_;
+    std::int64_t              max_;
+    std::atomic<std::int64_t> tokens_;
+};
+
+
+//! Counters of a retried operation, safe to share between threads and calls
+struct RetryMetrics {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> successes{0};
+    std::atomic<std::uint64_t> failures{0};          // calls which finally failed
+    std::atomic<std::uint64_t> attempts{0};
+    std::atomic<std::uint64_t> retries{0};
+    std::atomic<std::uint64_t> not_retryable{0};     // failures stopped by the classifier
+    std::atomic<std::uint64_t> budget_exhausted{0};
+    std::atomic<std::uint64_t> deadline_exceeded{0};
+    LatencyHistogram<>         latency_us;           // whole call, retries included
+    LatencyHistogram<>         attempts_per_call;
+
+    std::string to_string() const {
+        using std::to_string;
+        return "calls=" + to_string(calls.load()) + " ok=" + to_string(successes.load())
+            + " failed=" + to_string(failures.load()) + " attempts=" + to_string(attempts.load())
+            + " retries=" + to_string(retries.load()) + " not_retryable=" + to_string(not_retryable.load())
+            + " budget_exhausted=" + to_string(budget_exhausted.load())
+            + " deadline_exceeded=" + to_string(deadline_exceeded.load())
+            + " | latency(us) " + latency_us.to_string();
+    }
+};
+
+
+//! Classifier retrying only the given exception types (and their derived classes)
+template<typename... Exceptions>
+struct retry_on;
+
+template<>
+struct retry_on<> {
+    bool operator()(std::exception_ptr) const { return false; }
+};
+
+template<typename E, typename... Others>
+struct retry_on<E, Others...> {
+    bool operator()(std::exception_ptr e) const {
+        try { std::rethrow_exception(e); }
+        catch (const E&) { return true; }
+        catch (...) { return retry_on<Others...>{}(e); }
+    }
+};
+
+//! Default classifier : everything but contract violations (coin::fail_fast) is transient
+inline bool default_retryable(std::exception_ptr e) {
+    try { std::rethrow_exception(e); }
+    catch (const coin::fail_fast&) { return false; }
+    catch (...) { return true; }
+}
+
+
+//! How to retry : attempts, exponential backoff with jitter, deadline on the whole call,
+//! optional shared budget and error classifier. Setters chain :
+//!     auto policy = coin::RetryPolicy{}.attempts(5).backoff(10ms, 2s).deadline(5s);
+struct RetryPolicy {
+    using duration = std::chrono::milliseconds;
+
+    int                                     max_attempts{3};
+    duration                                initial_backoff{10};
+    duration                                max_backoff{1000};
+    double                                  multiplier{2.};
+    double                                  jitter{1.};           // part of the delay drawn at random, 1 : full jitter
+    duration                                total_deadline{0};    // 0 : none
+    std::shared_ptr<RetryBudget>            retry_budget;
+    std::function<bool(std::exception_ptr)> retryable{default_retryable};
+    std::function<void(int, duration, std::exception_ptr)> on_retry; // attempt which failed, delay before the next one
+
+    RetryPolicy& attempts(int n)                           { max_attempts = n; return *this; }
+    RetryPolicy& backoff(duration initial, duration max)   { initial_backoff = initial; max_backoff = max; return *this; }
+    RetryPolicy& growth(double m)                          { multiplier = m; return *this; }
+    RetryPolicy& with_jitter(double j)                     { jitter = j; return *this; }
+    RetryPolicy& deadline(duration d)                      { total_deadline = d; return *this; }
+    RetryPolicy& budget(std::shared_ptr<RetryBudget> b)    { retry_budget = std::move(b); return *this; }
+    template<typename Classifier>
+    RetryPolicy& retry_if(Classifier c)                    { retryable = std::move(c); return *this; }
+    template<typename Callback>
+    RetryPolicy& notify(Callback c)                        { on_retry = std::move(c); return *this; }
+
+    //! Delay after the failed attempt number `attempt` (1 based) :
+    //! min(max, initial * multiplier^(attempt-1)), the `jitter` part of it being uniform random
+    duration delay(int attempt) const {
+        double d = static_cast<double>(initial_backoff.count());
+        for (int i = 1; i < attempt && d < max_backoff.count(); i ++) { d *= multiplier; }
+        d = std::min(d, static_cast<double>(max_backoff.count()));
+        auto j = std::max(0., std::min(1., jitter));
+        std::uniform_real_distribution<double> unit(0., 1.);
+        d = d * (1. - j) + d * j * unit(rng());
+        return duration{static_cast<duration::rep>(d)};
+    }
+
+private:
+    static std::mt19937_64& rng() {
+        static thread_local std::mt19937_64 gen{std::random_device{}()};
+        return gen;
+    }
+};
+
+
+//! Bookkeeping of one call shared by the sync and async paths
+class RetryState {
+public:
+    RetryState(const RetryPolicy& policy, RetryMetrics* metrics)
+        : policy_(policy)
+        , metrics_{metrics}
+        , start_{retry_clock::now()} {
+        if (policy_.retry_budget) { policy_.retry_budget->deposit(); }
+        if (metrics_) { ++ metrics_->calls; }
+    }
+
+    void attempt_started() {
+        ++ attempt_;
+        if (metrics_) { ++ metrics_->attempts; }
+    }
+
+    //! After a failure : delay before the next attempt, or false when the error must be propagated
+    bool next_delay(std::exception_ptr error, RetryPolicy::duration& delay) {
+        if (!policy_.retryable(error)) {
+            if (metrics_) { ++ metrics_->not_retryable; }
+            return false;
+        }
+        if (attempt_ >= policy_.max_attempts) {
+            return false;
+        }
+        delay = policy_.delay(attempt_);
+        if (policy_.total_deadline.count() > 0 && retry_clock::now() + delay - start_ >= policy_.total_deadline) {
+            if (metrics_) { ++ metrics_->deadline_exceeded; }
+            return false;
+        }
+        if (policy_.retry_budget && !policy_.retry_budget->try_withdraw()) {
+            if (metrics_) { ++ metrics_->budget_exhausted; }
+            return false;
+        }
+        if (metrics_) { ++ metrics_->retries; }
+        if (policy_.on_retry) { policy_.on_retry(attempt_, delay, error); }
+        return true;
+    }
+
+    void finished(bool success) {
+        if (!metrics_) { return; }
+        ++ (success ? metrics_->successes : metrics_->failures);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(retry_clock::now() - start_).count();
+        metrics_->latency_us.record(static_cast<std::uint64_t>(us));
+        metrics_->attempts_per_call.record(static_cast<std::uint64_t>(attempt_));
+    }
+
+private:
+    RetryPolicy   policy_;
+    RetryMetrics* metrics_;
+    retry_clock::time_point start_;
+    int           attempt_{0};
+};
+
+
+template<typename R, typename F>
+std::enable_if_t<!std::is_void<R>::value, R> invoke_and_finish(RetryState& state, F& func) {
+    auto r = func();
+    state.finished(true);
+    return r;
+}
+
+template<typename R, typename F>
+std::enable_if_t<std::is_void<R>::value> invoke_and_finish(RetryState& state, F& func) {
+    func();
+    state.finished(true);
+}
+
+template<typename F>
+auto finish(RetryState& state, F& func) -> decltype(func()) {
+    return invoke_and_finish<decltype(func())>(state, func);
+}
+
+
+//! Call func() until it succeeds or the policy gives up (then the last exception is rethrown).
+//! The calling thread sleeps between attempts, see retry_async for the non blocking version.
+template<typename F>
+auto retry_call(const RetryPolicy& policy, F&& func, RetryMetrics* metrics = nullptr) -> decltype(func()) {
+    RetryState state{policy, metrics};
+    for (;;) {
+        state.attempt_started();
+        try {
+            return finish(state, func);
+        }
+        catch (...) {
+            RetryPolicy::duration delay;
+            if (!state.next_delay(std::current_exception(), delay)) {
+                state.finished(false);
+                throw;
+            }
+            std::this_thread::sleep_for(delay);
+        }
+    }
+}
+
+
+//! Runs tasks after a delay : one timer thread keeps a min heap of due times and hands
+//! the due tasks to a ThreadPool, so nothing ever sleeps on a pool worker.
+class DelayedScheduler {
+public:
+    using cancel_type = std::function<void(std::exception_ptr)>;
+
+    explicit DelayedScheduler(ThreadPool& pool = shared_thread_pool())
+        : pool_(pool)
+        , thread_{std::thread([this] { run(); }), Action::join} {}
+
+    //! Timers not yet due are cancelled (their cancel callback gets a shutdown error), then
+    //! waits until the users holding this scheduler (see retain) are gone
+    ~DelayedScheduler() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        stop_ = true;
+        cv_.notify_one();
+        idle_cv_.wait(lock, [this] { return users_ == 0; });
+    }
+
+    DelayedScheduler(const DelayedScheduler&)            = delete;
+    DelayedScheduler& operator=(const DelayedScheduler&) = delete;
+
+    ThreadPool& pool() { return pool_; }
+
+    //! cancel is called instead of task when the scheduler is destroyed before the due time
+    void schedule_after(std::chrono::milliseconds delay, std::function<void()> task, cancel_type cancel = {}) {
+        if (delay.count() <= 0) {
+            pool_.post(std::move(task));
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (!stop_) {
+                timers_.push(Timer{retry_clock::now() + delay, sequence_ ++, std::move(task), std::move(cancel)});
+                cv_.notify_one();
+                return;
+            }
+        }
+        if (cancel) { cancel(shutdown_error()); }
+    }
+
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return timers_.size();
+    }
+
+    //! Keep the scheduler alive : the destructor waits for the matching release()
+    void retain() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        ++ users_;
+    }
+    void release() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (-- users_ == 0) { idle_cv_.notify_all(); } // under the lock : *this may be gone right after
+    }
+
+private:
+    struct Timer {
+        retry_clock::time_point due;
+        std::uint64_t           sequence; // FIFO among equal due times
+        std::function<void()>   task;
+        cancel_type             cancel;
+        bool operator>(const Timer& o) const { return due != o.due ? due > o.due : sequence > o.sequence; }
+    };
+
+    static std::exception_ptr shutdown_error() {
+        return std::make_exception_ptr(std::runtime_error("DelayedScheduler: destroyed before the task was due"));
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (!stop_) {
+            if (timers_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            auto due = timers_.top().due;
+            if (retry_clock::now() < due) {
+                cv_.wait_until(lock, due);
+                continue;
+            }
+            auto task = std::move(const_cast<Timer&>(timers_.top()).task);
+            timers_.pop();
+            lock.unlock();
+            pool_.post(std::move(task));
+            lock.lock();
+        }
+        decltype(timers_) dropped;
+        std::swap(dropped, timers_);
+        lock.unlock();
+        for (; !dropped.empty(); dropped.pop()) {
+            auto& timer = const_cast<Timer&>(dropped.top());
+            if (timer.cancel) { timer.cancel(shutdown_error()); }
+        }
+    }
+
+    ThreadPool&                                                     pool_;
+    mutable std::mutex                                              mutex_;
+    std::condition_variable                                         cv_;
+    std::condition_variable                                         idle_cv_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::uint64_t                                                   sequence_{0};
+    std::size_t                                                     users_{0};
+    bool                                                            stop_{false};
+    ThreadGuard                                                     thread_; // last member : joined first
+};
+
+//! Process wide scheduler on shared_thread_pool()
+inline DelayedScheduler& shared_delayed_scheduler() {
+    static DelayedScheduler scheduler;
+    return scheduler;
+}
+
+
+template<typename R, typename F>
+class AsyncRetry : public std::enable_shared_from_this<AsyncRetry<R, F>> {
+public:
+    AsyncRetry(const RetryPolicy& policy, F func, RetryMetrics* metrics, DelayedScheduler& scheduler)
+        : state_(policy, metrics)
+        , func_(std::move(func))
+        , scheduler_(scheduler)
+        , result_{std::make_shared<_impl_pool::FutureState<R>>()} {
+        scheduler_.retain();
+    }
+
+    // the scheduler outlives every call in flight
+    ~AsyncRetry() { scheduler_.release(); }
+
+    AsyncRetry(const AsyncRetry&)            = delete;
+    AsyncRetry& operator=(const AsyncRetry&) = delete;
+
+    Future<R> future() { return Future<R>{result_}; }
+
+    void attempt() {
+        state_.attempt_started();
+        try {
+            set_result(std::is_void<R>{});
+            return;
+        }
+        catch (...) {
+            auto error = std::current_exception();
+            RetryPolicy::duration delay;
+            if (!state_.next_delay(error, delay)) {
+                state_.finished(false);
+                result_->set_exception(error);
+                return;
+            }
+            auto self = this->shared_from_this();
+            scheduler_.schedule_after(delay, [self] { self->attempt(); },
+                                      [self](std::exception_ptr shutdown) { self->abandon(shutdown); });
+        }
+    }
+
+    //! The scheduler went away before the next attempt
+    void abandon(std::exception_ptr error) {
+        state_.finished(false);
+        result_->set_exception(error);
+    }
+
+private:
+    void set_result(std::false_type) { auto r = func_(); state_.finished(true); result_->set_value(std::move(r)); }
+    void set_result(std::true_type)  { func_(); state_.finished(true); result_->set_value(); }
+
+    RetryState                                  state_;
+    F                                           func_;
+    DelayedScheduler&                           scheduler_;
+    std::shared_ptr<_impl_pool::FutureState<R>> result_;
+};
+
+//! Non blocking retry : attempts run on the scheduler's pool, the waits between them are
+//! timers, the returned Future gives the result or the last exception.
+template<typename F>
+auto retry_async(const RetryPolicy& policy, F&& func, RetryMetrics* metrics = nullptr,
+                 DelayedScheduler& scheduler = shared_delayed_scheduler()) -> Future<std::result_of_t<std::decay_t<F>()>> {
+    using result_type = std::result_of_t<std::decay_t<F>()>;
+    auto call = std::make_shared<AsyncRetry<result_type, std::decay_t<F>>>(policy, std::forward<F>(func), metrics, scheduler);
+    auto future = call->future();
+    scheduler.pool().post([call] { call->attempt(); });
+    return future;
+}
+
+} // ns _impl_retry
+
+using _impl_retry::RetryBudget;
+using _impl_retry::RetryMetrics;
+using _impl_retry::RetryPolicy;
+using _impl_retry::retry_on;
+using _impl_retry::retry_call;
+using _impl_retry::retry_async;
+using _impl_retry::DelayedScheduler;
+using _impl_retry::shared_delayed_scheduler;
+
+} // ns coin
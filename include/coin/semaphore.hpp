@@ -1,5 +1,22 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace coin {
 
@@ -78,4 +95,172 @@ inline semaphore::native_handle_type semaphore::native_handle() {
     return cv.native_handle();
 }
 
+
+namespace _impl_semaphore {
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
+
+} // ns _impl_semaphore
+
+
+//! Same interface as semaphore but uncontended notify()/wait() are a single atomic
+//! operation. count goes negative by the number of blocked waiters, so notify() only
+//! enters the kernel when somebody really sleeps; waiters spin a bounded number of
+//! times before blocking on a futex (Linux) or a mutex/condvar (elsewhere).
+class lightweight_semaphore {
+public:
+    explicit lightweight_semaphore(size_t n = 0, int spin_count = 256);
+    lightweight_semaphore(const lightweight_semaphore&) = delete;
+    lightweight_semaphore& operator=(const lightweight_semaphore&) = delete;
+
+    void notify();
+    void wait();
+    bool try_wait();
+    template<class Rep, class Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& d);
+    template<class Clock, class Duration>
+    bool wait_until(const std::chrono::time_point<Clock, Duration>& t);
+
+private:
+    bool spin_wait();
+    bool try_take_wakeup();
+    // sleep until a wakeup is available, at most rel_ns nanoseconds (negative : no timeout)
+    void park(long long rel_ns);
+    void unpark();
+
+    std::atomic<int>        count;
+    std::atomic<int>        wakeups{0};  // futex word : wakeups handed to blocked waiters
+    int                     spin;
+#ifndef __linux__
+    std::mutex              mutex;
+    std::condition_variable cv;
+#endif
+};
+
+inline lightweight_semaphore::lightweight_semaphore(size_t n, int spin_count) 
+    : count{static_cast<int>(n)}
+    , spin{std::thread::hardware_concurrency() > 1 ? spin_count : 0} {} // spinning on one cpu only delays the notifier
+
+inline void lightweight_semaphore::notify() {
+    if (count.fetch_add(1, std::memory_order_release) < 0) {
+        unpark();
+    }
+}
+
+inline bool lightweight_semaphore::try_wait() {
+    auto c = count.load(std::memory_order_relaxed);
+    while (c > 0) {
+        if (count.compare_exchange_weak(c, c - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool lightweight_semaphore::spin_wait() {
+    for (int i = 0; i < spin; i ++) {
+        if (try_wait()) {
+            return true;
+        }
+        _impl_semaphore::cpu_relax();
+    }
+    return false;
+}
+
+inline bool lightweight_semaphore::try_take_wakeup() {
+    auto w = wakeups.load(std::memory_order_relaxed);
+    while (w > 0) {
+        if (wakeups.compare_exchange_weak(w, w - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void lightweight_semaphore::wait() {
+    if (spin_wait()) {
+        return;
+    }
+    if (count.fetch_sub(1, std::memory_order_acquire) > 0) {
+        return;
+    }
+    while (!try_take_wakeup()) {
+        park(-1);
+    }
+}
+
+template<class Rep, class Period>
+bool lightweight_semaphore::wait_for(const std::chrono::duration<Rep, Period>& d) {
+    return wait_until(std::chrono::steady_clock::now() + d);
+}
+
+template<class Clock, class Duration>
+bool lightweight_semaphore::wait_until(const std::chrono::time_point<Clock, Duration>& t) {
+    if (try_wait()) {
+        return true;
+    }
+    if (count.fetch_sub(1, std::memory_order_acquire) > 0) {
+        return true;
+    }
+    for (;;) {
+        if (try_take_wakeup()) {
+            return true;
+        }
+        auto rel = std::chrono::duration_cast<std::chrono::nanoseconds>(t - Clock::now()).count();
+        if (rel <= 0) {
+            break;
+        }
+        park(rel);
+    }
+    // timed out : withdraw from the waiters unless a notify() already counted on us
+    auto c = count.load(std::memory_order_relaxed);
+    while (c < 0) {
+        if (count.compare_exchange_weak(c, c + 1, std::memory_order_relaxed)) {
+            return false;
+        }
+    }
+    while (!try_take_wakeup()) {
+        park(-1);
+    }
+    return true;
+}
+
+inline void lightweight_semaphore::park(long long rel_ns) {
+#ifdef __linux__
+    timespec ts;
+    timespec* timeout = nullptr;
+    if (rel_ns >= 0) {
+        ts.tv_sec  = static_cast<time_t>(rel_ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(rel_ns % 1000000000);
+        timeout = &ts;
+    }
+    // returns immediately if a wakeup was posted in between
+    syscall(SYS_futex, reinterpret_cast<int*>(&wakeups), FUTEX_WAIT_PRIVATE, 0, timeout, nullptr, 0);
+#else
+    std::unique_lock<std::mutex> lock{mutex};
+    auto available = [&]{ return wakeups.load(std::memory_order_relaxed) > 0; };
+    if (rel_ns < 0) {
+        cv.wait(lock, available);
+    }
+    else {
+        cv.wait_for(lock, std::chrono::nanoseconds(rel_ns), available);
+    }
+#endif
+}
+
+inline void lightweight_semaphore::unpark() {
+#ifdef __linux__
+    wakeups.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<int*>(&wakeups), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    std::lock_guard<std::mutex> lock{mutex};
+    wakeups.fetch_add(1, std::memory_order_release);
+    cv.notify_one();
+#endif
+}
+
 } // ns coin
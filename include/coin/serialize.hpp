@@ -0,0 +1,713 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ios>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "pretty_print.hpp"
+
+namespace coin {
+
+namespace _impl_serialize {
+
+using _impl_stringify::void_t;
+using _impl_stringify::is_pair;
+using _impl_stringify::is_container;
+using _impl_stringify::StringSink;
+using _impl_stringify::write_integer;
+
+[[noreturn]] inline void fail(const char* what) {
+    throw std::ios_base::failure(std::string{"coin::serialize: "} + what);
+}
+
+
+// shape of a serialized type, walked the same way by both formats
+
+enum class shape { boolean, integer, floating, string, pair, array, container };
+
+template<typename T> struct is_std_array : std::false_type {};
+template<typename T, std::size_t N> struct is_std_array<std::array<T, N>> : std::true_type {};
+
+template<typename T>
+using shape_of = std::integral_constant<shape,
+    std::is_same<T, bool>::value          ? shape::boolean
+    : std::is_integral<T>::value          ? shape::integer
+    : std::is_floating_point<T>::value    ? shape::floating
+    : std::is_same<T, std::string>::value ? shape::string
+    : is_pair<T>::value                   ? shape::pair
+    : is_std_array<T>::value              ? shape::array
+    :                                       shape::container>;
+
+//! Element type read back : the key of map pairs is not const
+template<typename T>
+struct mutable_value { using type = T; };
+template<typename K, typename V>
+struct mutable_value<std::pair<const K, V>> { using type = std::pair<K, V>; };
+
+//! Contiguous arithmetic elements are copied as a block of host order (little endian) bytes
+template<typename C, typename V = typename C::value_type>
+using is_block = std::integral_constant<bool,
+    std::is_arithmetic<V>::value && !std::is_same<V, bool>::value
+    && (std::is_same<C, std::vector<V, typename C::allocator_type>>::value)>;
+
+template<typename C, typename = void>
+struct has_emplace_back : std::false_type {};
+template<typename C>
+struct has_emplace_back<C, void_t<decltype(std::declval<C&>().emplace_back(std::declval<typename C::value_type>()))>> : std::true_type {};
+
+template<typename C, typename V>
+void add_element(C& c, V&& v, std::true_type /*emplace_back*/) { c.emplace_back(std::forward<V>(v)); }
+
+template<typename C, typename V>
+void add_element(C& c, V&& v, std::false_type /*emplace_back*/) { c.insert(c.end(), std::forward<V>(v)); }
+
+template<typename C, typename = void>
+struct has_reserve : std::false_type {};
+template<typename C>
+struct has_reserve<C, void_t<decltype(std::declval<C&>().reserve(std::size_t{}))>> : std::true_type {};
+
+template<typename C> void reserve(C& c, std::size_t n, std::true_type)  { c.reserve(n); }
+template<typename C> void reserve(C&, std::size_t, std::false_type) {}
+
+
+// binary : unsigned integers as LEB128 varints, signed ones zigzag encoded first, floating
+// points as their bytes, strings and containers prefixed by their length
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out) : out_(out) {}
+
+    void varint(std::uint64_t v) {
+        char buf[10];
+        std::size_t n = 0;
+        while (v >= 0x80) {
+            buf[n++] = static_cast<char>((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        buf[n++] = static_cast<char>(v);
+        out_.append(buf, n);
+    }
+
+    void bytes(const void* p, std::size_t n) {
+        if (n) { out_.append(static_cast<const char*>(p), n); }
+    }
+
+    template<typename T> void write(const T& t) { write(t, shape_of<T>{}); }
+
+private:
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::boolean>) { out_.push_back(t ? 1 : 0); }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::integer>) { integer(t, std::is_signed<T>{}); }
+
+    template<typename T>
+    void integer(T t, std::false_type /*signed*/) { varint(static_cast<std::uint64_t>(t)); }
+
+    template<typename T>
+    void integer(T t, std::true_type /*signed*/) {
+        auto v = static_cast<std::int64_t>(t);
+        varint((static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63));
+    }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::floating>) { bytes(&t, sizeof(T)); }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::string>) {
+        varint(t.size());
+        bytes(t.data(), t.size());
+    }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::pair>) {
+        write(t.first);
+        write(t.second);
+    }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::array>) {
+        for (auto const& v : t) { write(v); }
+    }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::container>) {
+        static_assert(is_container<T>::value, "coin::serialize: type not supported");
+        varint(t.size());
+        elements(t, is_block<T>{});
+    }
+
+    template<typename T>
+    void elements(const T& t, std::true_type /*block*/) { bytes(t.data(), t.size() * sizeof(typename T::value_type)); }
+
+    template<typename T>
+    void elements(const T& t, std::false_type /*block*/) {
+        for (auto const& v : t) { write(v); }
+    }
+
+    std::string& out_;
+};
+
+class BinaryReader {
+public:
+    BinaryReader(const char* data, std::size_t size) : p_{data}, end_{data + size} {}
+
+    std::uint64_t varint() {
+        std::uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p_ == end_) { fail("truncated varint"); }
+            auto c = static_cast<unsigned char>(*p_ ++);
+            v |= static_cast<std::uint64_t>(c & 0x7F) << shift;
+            if (!(c & 0x80)) { return v; }
+        }
+        fail("malformed varint");
+    }
+
+    void bytes(void* p, std::size_t n) {
+        if (n > left()) { fail("truncated input"); }
+        if (n) { std::memcpy(p, p_, n); }
+        p_ += n;
+    }
+
+    std::size_t left() const { return static_cast<std::size_t>(end_ - p_); }
+
+    template<typename T> void read(T& t) { read(t, shape_of<T>{}); }
+
+private:
+    // every element takes at least one byte : bounds the allocations of a corrupted length
+    std::size_t length(std::size_t element_size = 1) {
+        auto n = varint();
+        if (n > left() / element_size) { fail("length larger than the input"); }
+        return static_cast<std::size_t>(n);
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::boolean>) {
+        unsigned char c;
+        bytes(&c, 1);
+        t = c != 0;
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::integer>) { integer(t, std::is_signed<T>{}); }
+
+    template<typename T>
+    void integer(T& t, std::false_type /*signed*/) {
+        auto v = varint();
+        if (v > static_cast<std::uint64_t>(std::numeric_limits<T>::max())) { fail("integer out of range"); }
+        t = static_cast<T>(v);
+    }
+
+    template<typename T>
+    void integer(T& t, std::true_type /*signed*/) {
+        auto u = varint();
+        auto v = static_cast<std::int64_t>(u >> 1) ^ -static_cast<std::int64_t>(u & 1);
+        if (v < std::numeric_limits<T>::min() || v > std::numeric_limits<T>::max()) { fail("integer out of range"); }
+        t = static_cast<T>(v);
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::floating>) { bytes(&t, sizeof(T)); }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::string>) {
+        auto n = length();
+        t.assign(p_, n);
+        p_ += n;
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::pair>) {
+        read(t.first);
+        read(t.second);
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::array>) {
+        for (auto& v : t) { read(v); }
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::container>) {
+        static_assert(is_container<T>::value, "coin::serialize: type not supported");
+        t.clear();
+        elements(t, is_block<T>{});
+    }
+
+    template<typename T>
+    void elements(T& t, std::true_type /*block*/) {
+        auto n = length(sizeof(typename T::value_type));
+        t.resize(n);
+        bytes(t.data(), n * sizeof(typename T::value_type));
+    }
+
+    template<typename T>
+    void elements(T& t, std::false_type /*block*/) {
+        auto n = length();
+        reserve(t, n, has_reserve<T>{});
+        for (std::size_t i = 0; i < n; i ++) {
+            typename mutable_value<typename T::value_type>::type v;
+            read(v);
+            add_element(t, std::move(v), has_emplace_back<T>{});
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+
+// JSON : maps keyed by strings are objects, other maps arrays of [key,value] pairs,
+// non finite floating points are null (read back as NaN)
+
+template<typename T, typename = void>
+struct is_string_keyed : std::false_type {};
+template<typename T>
+struct is_string_keyed<T, void_t<typename T::key_type, typename T::mapped_type>>
+    : std::is_same<typename T::key_type, std::string> {};
+
+//! Shortest of 15 or 17 significant digits reading back to the same value (0.1 and not 0.10000000000000001)
+inline int format_float(char* buf, std::size_t n, double v) {
+    auto len = std::snprintf(buf, n, "%.15g", v);
+    return std::strtod(buf, nullptr) == v ? len : std::snprintf(buf, n, "%.17g", v);
+}
+inline int format_float(char* buf, std::size_t n, float v) {
+    auto len = std::snprintf(buf, n, "%.6g", static_cast<double>(v));
+    return std::strtof(buf, nullptr) == v ? len : std::snprintf(buf, n, "%.9g", static_cast<double>(v));
+}
+inline int format_float(char* buf, std::size_t n, long double v) { return std::snprintf(buf, n, "%.21Lg", v); }
+
+inline void parse_float(const char* s, char** stop, double& v)      { v = std::strtod(s, stop); }
+inline void parse_float(const char* s, char** stop, float& v)       { v = std::strtof(s, stop); }
+inline void parse_float(const char* s, char** stop, long double& v) { v = std::strtold(s, stop); }
+
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out), sink_{out} {}
+
+    template<typename T> void write(const T& t) { write(t, shape_of<T>{}); }
+
+private:
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::boolean>) { out_ += t ? "true" : "false"; }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::integer>) { write_integer(sink_, t, std::is_signed<T>{}); }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::floating>) {
+        if (!std::isfinite(t)) {
+            out_ += "null";
+            return;
+        }
+        char buf[48];
+        auto n = format_float(buf, sizeof(buf), t);
+        out_.append(buf, static_cast<std::size_t>(n));
+    }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::string>) { string(t); }
+
+    void string(const std::string& s) {
+        static const char hex[] = "0123456789abcdef";
+        out_.push_back('"');
+        std::size_t run = 0; // characters copied as they are, in one append
+        for (std::size_t i = 0; i < s.size(); i ++) {
+            auto c = static_cast<unsigned char>(s[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') { continue; }
+            out_.append(s, run, i - run);
+            run = i + 1;
+            switch (c) {
+                case '"':  out_ += "\\\""; break;
+                case '\\': out_ += "\\\\"; break;
+                case '\n': out_ += "\\n";  break;
+                case '\r': out_ += "\\r";  break;
+                case '\t': out_ += "\\t";  break;
+                default:
+                    out_ += "\\u00";
+                    out_.push_back(hex[c >> 4]);
+                    out_.push_back(hex[c & 0xF]);
+            }
+        }
+        out_.append(s, run, s.size() - run);
+        out_.push_back('"');
+    }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::pair>) {
+        out_.push_back('[');
+        write(t.first);
+        out_.push_back(',');
+        write(t.second);
+        out_.push_back(']');
+    }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::array>) { sequence(t); }
+
+    template<typename T>
+    void write(const T& t, std::integral_constant<shape, shape::container>) {
+        static_assert(is_container<T>::value, "coin::serialize: type not supported");
+        container(t, is_string_keyed<T>{});
+    }
+
+    template<typename T>
+    void sequence(const T& t) {
+        out_.push_back('[');
+        bool first = true;
+        for (auto const& v : t) {
+            if (!first) { out_.push_back(','); }
+            first = false;
+            write(v);
+        }
+        out_.push_back(']');
+    }
+
+    template<typename T>
+    void container(const T& t, std::false_type /*object*/) { sequence(t); }
+
+    template<typename T>
+    void container(const T& t, std::true_type /*object*/) {
+        out_.push_back('{');
+        bool first = true;
+        for (auto const& kv : t) {
+            if (!first) { out_.push_back(','); }
+            first = false;
+            string(kv.first);
+            out_.push_back(':');
+            write(kv.second);
+        }
+        out_.push_back('}');
+    }
+
+    std::string& out_;
+    StringSink   sink_;
+};
+
+class JsonReader {
+public:
+    //! text must stay alive, its terminating null stops the number parsing
+    explicit JsonReader(const std::string& text) : p_{text.c_str()}, end_{text.c_str() + text.size()} {}
+
+    template<typename T> void read(T& t) { read(t, shape_of<T>{}); }
+
+    void finish() {
+        skip();
+        if (p_ != end_) { fail("unexpected characters after the JSON value"); }
+    }
+
+private:
+    void skip() {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) { ++ p_; }
+    }
+
+    void expect(char c) {
+        skip();
+        if (p_ == end_ || *p_ != c) { fail_at("unexpected character"); }
+        ++ p_;
+    }
+
+    bool accept(char c) {
+        skip();
+        if (p_ != end_ && *p_ == c) {
+            ++ p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char* word) {
+        skip();
+        auto n = std::strlen(word);
+        if (static_cast<std::size_t>(end_ - p_) >= n && std::memcmp(p_, word, n) == 0) {
+            p_ += n;
+            return true;
+        }
+        return false;
+    }
+
+    [[noreturn]] void fail_at(const char* what) const {
+        fail((std::string{what} + " at \"" + std::string(p_, std::min<std::size_t>(16, end_ - p_)) + "\"").c_str());
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::boolean>) {
+        if (literal("true"))       { t = true; }
+        else if (literal("false")) { t = false; }
+        else                       { fail_at("boolean expected"); }
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::integer>) {
+        skip();
+        bool negative = p_ != end_ && *p_ == '-';
+        if (negative) { ++ p_; }
+        if (p_ == end_ || *p_ < '0' || *p_ > '9') { fail_at("integer expected"); }
+        std::uint64_t v = 0;
+        for (; p_ != end_ && *p_ >= '0' && *p_ <= '9'; ++ p_) {
+            auto d = static_cast<std::uint64_t>(*p_ - '0');
+            if (v > (std::numeric_limits<std::uint64_t>::max() - d) / 10) { fail_at("integer out of range"); }
+            v = v * 10 + d;
+        }
+        integer(t, v, negative, std::is_signed<T>{});
+    }
+
+    template<typename T>
+    void integer(T& t, std::uint64_t v, bool negative, std::false_type /*signed*/) {
+        if ((negative && v) || v > static_cast<std::uint64_t>(std::numeric_limits<T>::max())) { fail_at("integer out of range"); }
+        t = static_cast<T>(v);
+    }
+
+    template<typename T>
+    void integer(T& t, std::uint64_t v, bool negative, std::true_type /*signed*/) {
+        auto limit = static_cast<std::uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        if (v > limit) { fail_at("integer out of range"); }
+        t = negative ? static_cast<T>(static_cast<T>(-static_cast<std::int64_t>(v - 1)) - 1) : static_cast<T>(v);
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::floating>) {
+        if (literal("null")) {
+            t = std::numeric_limits<T>::quiet_NaN();
+            return;
+        }
+        skip();
+        char* stop = nullptr;
+        parse_float(p_, &stop, t);
+        if (stop == p_) { fail_at("number expected"); }
+        p_ = stop;
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::string>) { string(t); }
+
+    void string(std::string& s) {
+        expect('"');
+        s.clear();
+        for (;;) {
+            auto run = p_;
+            while (p_ != end_ && *p_ != '"' && *p_ != '\\') { ++ p_; }
+            s.append(run, p_);
+            if (p_ == end_) { fail("unterminated string"); }
+            if (*p_ ++ == '"') { return; }
+            if (p_ == end_) { fail("unterminated string"); }
+            switch (*p_ ++) {
+                case '"':  s.push_back('"');  break;
+                case '\\': s.push_back('\\'); break;
+                case '/':  s.push_back('/');  break;
+                case 'b':  s.push_back('\b'); break;
+                case 'f':  s.push_back('\f'); break;
+                case 'n':  s.push_back('\n'); break;
+                case 'r':  s.push_back('\r'); break;
+                case 't':  s.push_back('\t'); break;
+                case 'u':  utf8(s, code_point()); break;
+                default:   fail_at("bad escape");
+            }
+        }
+    }
+
+    std::uint32_t hex4() {
+        if (end_ - p_ < 4) { fail("truncated \\u escape"); }
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; i ++, ++ p_) {
+            auto c = *p_;
+            v <<= 4;
+            if (c >= '0' && c <= '9')      { v |= static_cast<std::uint32_t>(c - '0'); }
+            else if (c >= 'a' && c <= 'f') { v |= static_cast<std::uint32_t>(c - 'a' + 10); }
+            else if (c >= 'A' && c <= 'F') { v |= static_cast<std::uint32_t>(c - 'A' + 10); }
+            else                           { fail_at("bad \\u escape"); }
+        }
+        return v;
+    }
+
+    std::uint32_t code_point() {
+        auto cp = hex4();
+        if (cp >= 0xD800 && cp < 0xDC00 && end_ - p_ >= 2 && p_[0] == '\\' && p_[1] == 'u') {
+            p_ += 2;
+            auto low = hex4();
+            if (low < 0xDC00 || low > 0xDFFF) { fail_at("bad surrogate pair"); }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        return cp;
+    }
+
+    static void utf8(std::string& s, std::uint32_t cp) {
+        if (cp < 0x80) {
+            s.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800) {
+            s.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000) {
+            s.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else {
+            s.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::pair>) {
+        expect('[');
+        read(t.first);
+        expect(',');
+        read(t.second);
+        expect(']');
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::array>) {
+        expect('[');
+        for (std::size_t i = 0; i < t.size(); i ++) {
+            if (i) { expect(','); }
+            read(t[i]);
+        }
+        expect(']');
+    }
+
+    template<typename T>
+    void read(T& t, std::integral_constant<shape, shape::container>) {
+        static_assert(is_container<T>::value, "coin::serialize: type not supported");
+        t.clear();
+        container(t, is_string_keyed<T>{});
+    }
+
+    template<typename T>
+    void container(T& t, std::false_type /*object*/) {
+        expect('[');
+        if (accept(']')) { return; }
+        do {
+            typename mutable_value<typename T::value_type>::type v;
+            read(v);
+            add_element(t, std::move(v), has_emplace_back<T>{});
+        } while (accept(','));
+        expect(']');
+    }
+
+    template<typename T>
+    void container(T& t, std::true_type /*object*/) {
+        expect('{');
+        if (accept('}')) { return; }
+        do {
+            typename mutable_value<typename T::value_type>::type kv;
+            string(kv.first);
+            expect(':');
+            read(kv.second);
+            add_element(t, std::move(kv), has_emplace_back<T>{});
+        } while (accept(','));
+        expect('}');
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+
+//! Append the binary encoding of t to out
+template<typename T>
+void to_binary(std::string& out, const T& t) {
+    BinaryWriter{out}.write(t);
+}
+
+template<typename T>
+std::string to_binary(const T& t) {
+    std::string out;
+    to_binary(out, t);
+    return out;
+}
+
+//! Decode a value written by to_binary, throw std::ios_base::failure on malformed input
+template<typename T>
+T from_binary(const char* data, std::size_t size) {
+    BinaryReader in{data, size};
+    T t{};
+    in.read(t);
+    if (in.left()) { fail("unexpected bytes after the value"); }
+    return t;
+}
+
+template<typename T>
+T from_binary(const std::string& data) { return from_binary<T>(data.data(), data.size()); }
+
+//! Binary encoding prefixed by its size, several values can follow each other in a stream
+template<typename T>
+void serialize(std::ostream& os, const T& t) {
+    auto data = to_binary(t);
+    std::string size;
+    BinaryWriter{size}.varint(data.size());
+    os.write(size.data(), static_cast<std::streamsize>(size.size()));
+    os.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+template<typename T>
+T deserialize(std::istream& is) {
+    std::uint64_t size = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        auto c = is.get();
+        if (c == std::char_traits<char>::eof() || shift >= 64) { fail("truncated size"); }
+        size |= static_cast<std::uint64_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) { break; }
+    }
+    std::string data;
+    // read by chunks : a corrupted size fails on the stream instead of allocating it all
+    char buf[1 << 16];
+    while (data.size() < size) {
+        auto n = std::min<std::uint64_t>(sizeof(buf), size - data.size());
+        if (!is.read(buf, static_cast<std::streamsize>(n))) { fail("truncated input"); }
+        data.append(buf, static_cast<std::size_t>(n));
+    }
+    return from_binary<T>(data);
+}
+
+//! Append the JSON text of t to out
+template<typename T>
+void to_json(std::string& out, const T& t) {
+    JsonWriter{out}.write(t);
+}
+
+template<typename T>
+std::string to_json(const T& t) {
+    std::string out;
+    to_json(out, t);
+    return out;
+}
+
+//! Parse JSON written by to_json (or by hand) into T, throw std::ios_base::failure on error
+template<typename T>
+T from_json(const std::string& text) {
+    JsonReader in{text};
+    T t{};
+    in.read(t);
+    in.finish();
+    return t;
+}
+
+} // ns _impl_serialize
+
+using _impl_serialize::to_binary;
+using _impl_serialize::from_binary;
+using _impl_serialize::serialize;
+using _impl_serialize::deserialize;
+using _impl_serialize::to_json;
+using _impl_serialize::from_json;
+
+} // ns coin
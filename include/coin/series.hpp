@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "algorithm.hpp"
+#include "except.hpp"
+#include "flat_map.hpp"
+
+namespace coin {
+
+namespace _impl_series {
+
+template<typename Key, typename Value>
+void append_chunk(std::map<Key, Value>& output, std::map<Key, Value>&& chunk) {
+    Precondition(output.empty() || chunk.empty() || output.rbegin()->first < chunk.begin()->first,
+                 "SeriesBuilder: chunk must start after the last key!");
+    for (auto& p : chunk) { output.emplace_hint(output.end(), p.first, std::move(p.second)); }
+}
+
+template<typename Key, typename Value, typename Comp>
+void append_chunk(flat_map<Key, Value, Comp>& output, flat_map<Key, Value, Comp>&& chunk) {
+    output.append(std::move(chunk));
+}
+
+
+//! Stitch a series from consecutive chunks. With rescale each chunk is multiplied in place
+//! by last value / chunk first value before being moved at the end (see insert_with_rescale),
+//! so the work per append is O(chunk) and nothing already built is copied.
+template<typename Key, typename Value, typename Map = flat_map<Key, Value>>
+class SeriesBuilder {
+public:
+    using map_type = Map;
+
+    explicit SeriesBuilder(bool rescale = true) : rescale_{rescale} {}
+
+    void append(Map chunk) {
+        if (chunk.empty()) { return; }
+        if (rescale_) {
+            insert_with_rescale(series_, std::move(chunk));
+        }
+        else {
+            append_chunk(series_, std::move(chunk));
+        }
+        ++ chunks_;
+    }
+
+    std::size_t size()   const { return series_.size(); }
+    std::size_t chunks() const { return chunks_; }
+    const Map&  series() const { return series_; }
+
+    //! Give the built series away, the builder restarts empty
+    Map release() {
+        Map out;
+        std::swap(out, series_);
+        chunks_ = 0;
+        return out;
+    }
+
+private:
+    Map         series_;
+    std::size_t chunks_{0};
+    bool        rescale_;
+};
+
+
+//! Align several series on their common keys while their chunks arrive, in any order.
+//! Points not yet aligned wait in a per series buffer; each append runs the k-way merge
+//! of the buffers as far as every series has data, so an append costs O(chunk) amortized
+//! and the aligned result (index + one value column per series) only grows at the end.
+//! A key missing from one series is dropped from all, as maps_super_intersection does.
+template<typename Key, typename Value>
+class SeriesAligner {
+public:
+    explicit SeriesAligner(std::size_t series_count, bool rescale = true)
+        : pending_(series_count)
+        , columns_(series_count)
+        , rescale_{rescale} {
+        Precondition(series_count > 0, "SeriesAligner: at least one series is needed!");
+    }
+
+    std::size_t series_count() const { return columns_.size(); }
+
+    //! Feed the next chunk of series s : pairs sorted by key, all after the last key fed for s
+    template<typename Chunk>
+    void append(std::size_t s, const Chunk& chunk) {
+        Precondition(s < series_count(), "SeriesAligner: series index out of range!");
+        auto& buf = pending_[s];
+        auto it = std::begin(chunk);
+        if (it == std::end(chunk)) { return; }
+        // same stitching as insert_with_rescale : the chunk starts at the last value stored
+        Value factor = (rescale_ && buf.has_last) ? buf.last_value / (*it).second : Value(1);
+        for (; it != std::end(chunk); ++ it) {
+            auto const& p = *it;
+            Precondition(!buf.has_last || buf.last_key < p.first, "SeriesAligner: keys must be increasing!");
+            buf.points.emplace_back(p.first, p.second * factor);
+            buf.last_key   = p.first;
+            buf.last_value = buf.points.back().second;
+            buf.has_last   = true;
+        }
+        align();
+    }
+
+    //! Keys present in every series so far
+    const std::vector<Key>&   index()                const { return index_; }
+    const std::vector<Value>& column(std::size_t s)  const { return columns_[s]; }
+    std::size_t               size()                 const { return index_.size(); }
+    //! Points of series s waiting for the other series
+    std::size_t               pending(std::size_t s) const { return pending_[s].points.size() - pending_[s].head; }
+
+    //! Aligned series s as a flat_map (copy)
+    flat_map<Key, Value> series(std::size_t s) const { return flat_map<Key, Value>{index_, columns_[s]}; }
+
+private:
+    struct Pending {
+        std::vector<std::pair<Key, Value>> points;
+        std::size_t head{0};
+        Key         last_key{};
+        Value       last_value{};
+        bool        has_last{false};
+
+        bool empty() const { return head == points.size(); }
+        const Key& front_key() const { return points[head].first; }
+        void compact() {
+            if (head > 0 && head * 2 >= points.size()) {
+                points.erase(points.begin(), points.begin() + static_cast<std::ptrdiff_t>(head));
+                head = 0;
+            }
+        }
+    };
+
+    void align() {
+        auto n = pending_.size();
+        for (;;) {
+            const Key* target = nullptr;
+            for (auto const& p : pending_) {
+                if (p.empty()) { target = nullptr; break; }
+                if (!target || *target < p.front_key()) { target = &p.front_key(); }
+            }
+            if (!target) { break; }
+            Key key = *target;
+            bool everywhere = true;
+            bool exhausted = false;
+            for (auto& p : pending_) {
+                while (!p.empty() && p.front_key() < key) { ++ p.head; }
+                if (p.empty()) { exhausted = true; break; }
+                if (key < p.front_key()) { everywhere = false; }
+            }
+            if (exhausted) { break; }
+            if (everywhere) {
+                index_.push_back(key);
+                for (std::size_t s = 0; s < n; s ++) {
+                    columns_[s].push_back(pending_[s].points[pending_[s].head].second);
+                    ++ pending_[s].head;
+                }
+            }
+        }
+        for (auto& p : pending_) { p.compact(); }
+    }
+
+    std::vector<Pending>            pending_;
+    std::vector<Key>                index_;
+    std::vector<std::vector<Value>> columns_;
+    bool                            rescale_;
+};
+
+} // ns _impl_series
+
+using _impl_series::SeriesBuilder;
+using _impl_series::SeriesAligner;
+
+} // ns coin
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <immintrin.h>
+#define COIN_SIMD_FIND_X86 1
+#endif
+
+namespace coin {
+
+namespace _impl_simd_find {
+
+//! Types searched with vector compares : bitwise equality must be == (true for integers),
+//! floats go through the floating point compare so NaN and -0. behave as with std::find
+template<typename T>
+using is_simd_searchable = std::integral_constant<bool,
+    (std::is_integral<T>::value && !std::is_same<T, bool>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8))
+    || std::is_same<T, float>::value || std::is_same<T, double>::value>;
+
+template<typename T>
+const T* find_scalar(const T* first, const T* last, T val) {
+    for (; first != last; ++ first) {
+        if (*first == val) { return first; }
+    }
+    return last;
+}
+
+#ifdef COIN_SIMD_FIND_X86
+
+// 16 bytes compare of one block, bit i of the mask set when byte i belongs to a matching element
+inline int sse_match(__m128i block, std::uint16_t v) { return _mm_movemask_epi8(_mm_cmpeq_epi16(block, _mm_set1_epi16(static_cast<short>(v)))); }
+inline int sse_match(__m128i block, std::uint32_t v) { return _mm_movemask_epi8(_mm_cmpeq_epi32(block, _mm_set1_epi32(static_cast<int>(v)))); }
+inline int sse_match(__m128i block, std::uint64_t v) {
+    // SSE2 has no 64 bits compare : both 32 bits halves must match
+    auto eq = _mm_cmpeq_epi32(block, _mm_set1_epi64x(static_cast<long long>(v)));
+    return _mm_movemask_epi8(_mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1))));
+}
+inline int sse_match(__m128i block, float v)  { return _mm_movemask_epi8(_mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(block), _mm_set1_ps(v)))); }
+inline int sse_match(__m128i block, double v) { return _mm_movemask_epi8(_mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(block), _mm_set1_pd(v)))); }
+
+template<typename T, typename Key>
+const T* find_sse2(const T* first, const T* last, Key key) {
+    constexpr std::size_t lanes = 16 / sizeof(T);
+    auto p = first;
+    for (; static_cast<std::size_t>(last - p) >= lanes; p += lanes) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if (auto m = sse_match(block, key)) { return p + __builtin_ctz(static_cast<unsigned>(m)) / sizeof(T); }
+    }
+    for (; p != last; ++ p) {
+        if (*p == static_cast<T>(key)) { return p; }
+    }
+    return last;
+}
+
+#if defined(__GNUC__)
+#define COIN_SIMD_FIND_AVX2 1
+
+__attribute__((target("avx2"))) inline int avx2_match(__m256i block, std::uint16_t v) { return _mm256_movemask_epi8(_mm256_cmpeq_epi16(block, _mm256_set1_epi16(static_cast<short>(v)))); }
+__attribute__((target("avx2"))) inline int avx2_match(__m256i block, std::uint32_t v) { return _mm256_movemask_epi8(_mm256_cmpeq_epi32(block, _mm256_set1_epi32(static_cast<int>(v)))); }
+__attribute__((target("avx2"))) inline int avx2_match(__m256i block, std::uint64_t v) { return _mm256_movemask_epi8(_mm256_cmpeq_epi64(block, _mm256_set1_epi64x(static_cast<long long>(v)))); }
+__attribute__((target("avx2"))) inline int avx2_match(__m256i block, float v)  { return _mm256_movemask_epi8(_mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(block), _mm256_set1_ps(v), _CMP_EQ_OQ))); }
+__attribute__((target("avx2"))) inline int avx2_match(__m256i block, double v) { return _mm256_movemask_epi8(_mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(block), _mm256_set1_pd(v), _CMP_EQ_OQ))); }
+
+//! 4 blocks of 32 bytes per iteration, OR-ed together so the loop has a single branch
+template<typename T, typename Key>
+__attribute__((target("avx2"))) const T* find_avx2(const T* first, const T* last, Key key) {
+    constexpr std::size_t lanes = 32 / sizeof(T);
+    auto p = first;
+    for (; static_cast<std::size_t>(last - p) >= 4 * lanes; p += 4 * lanes) {
+        auto b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        auto b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + lanes));
+        auto b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2 * lanes));
+        auto b3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3 * lanes));
+        if (avx2_match(b0, key) | avx2_match(b1, key) | avx2_match(b2, key) | avx2_match(b3, key)) { break; }
+    }
+    for (; static_cast<std::size_t>(last - p) >= lanes; p += lanes) {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        if (auto m = avx2_match(block, key)) { return p + __builtin_ctz(static_cast<unsigned>(m)) / sizeof(T); }
+    }
+    for (; p != last; ++ p) {
+        if (*p == static_cast<T>(key)) { return p; }
+    }
+    return last;
+}
+
+inline bool has_avx2() {
+    static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return avx2;
+}
+#endif
+
+// key passed to the kernels : unsigned of the same width for integers, the value itself for floats
+template<typename T, bool Integral = std::is_integral<T>::value> struct simd_key { using type = T; };
+template<typename T> struct simd_key<T, true> {
+    using type = std::conditional_t<sizeof(T) == 2, std::uint16_t, std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>;
+};
+
+#endif // COIN_SIMD_FIND_X86
+
+template<typename T>
+const T* find_dispatch(const T* first, const T* last, T val, std::true_type /*byte*/) {
+    auto p = std::memchr(first, static_cast<unsigned char>(val), static_cast<std::size_t>(last - first));
+    return p ? static_cast<const T*>(p) : last;
+}
+
+template<typename T>
+const T* find_dispatch(const T* first, const T* last, T val, std::false_type /*byte*/) {
+#ifdef COIN_SIMD_FIND_X86
+    typename simd_key<T>::type key;
+    static_assert(sizeof(key) == sizeof(T), "simd key must have the size of the element");
+    std::memcpy(&key, &val, sizeof(T));
+#ifdef COIN_SIMD_FIND_AVX2
+    if (has_avx2()) { return find_avx2(first, last, key); }
+#endif
+    return find_sse2(first, last, key);
+#else
+    return find_scalar(first, last, val);
+#endif
+}
+
+//! First element equal to val in [first,last) (last if none) :
+//! memchr for bytes, AVX2 (when the cpu has it) or SSE2 compare + movemask otherwise
+template<typename T, typename = std::enable_if_t<is_simd_searchable<T>::value>>
+const T* find_contiguous(const T* first, const T* last, T val) {
+    return find_dispatch(first, last, val, std::integral_constant<bool, sizeof(T) == 1>{});
+}
+
+//! Contiguous iterators of the standard containers, reduced to pointers
+template<typename It, typename V = typename std::iterator_traits<It>::value_type>
+using is_contiguous_iterator = std::integral_constant<bool,
+    std::is_pointer<It>::value
+    || std::is_same<It, typename std::vector<V>::iterator>::value
+    || std::is_same<It, typename std::vector<V>::const_iterator>::value
+    || std::is_same<It, typename std::basic_string<char>::iterator>::value
+    || std::is_same<It, typename std::basic_string<char>::const_iterator>::value>;
+
+} // ns _impl_simd_find
+
+using _impl_simd_find::find_contiguous;
+using _impl_simd_find::is_simd_searchable;
+using _impl_simd_find::is_contiguous_iterator;
+
+} // ns coin
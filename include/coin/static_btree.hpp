@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "except.hpp"
+
+namespace coin {
+
+namespace _impl_static_btree {
+
+//! Read only search index over a sorted sequence, laid out as a static B+ tree :
+//! the bottom level is the sorted keys cut in blocks of B, every upper level holds the
+//! last (largest) key of each block of the level below. A search reads one block per
+//! level (log_B(n) cache misses instead of log_2(n)) and picks the child by counting
+//! the keys below the query, a branchless loop the compiler vectorizes.
+//! lower/upper_bound_index give the same positions as std::lower/upper_bound on the input.
+template<typename T, typename Compare = std::less<T>, std::size_t B = 64 / sizeof(T) < 8 ? 8 : 64 / sizeof(T)>
+class StaticBTree {
+public:
+    using value_type = T;
+
+    StaticBTree() = default;
+
+    template<typename InputIt>
+    StaticBTree(InputIt first, InputIt last, const Compare& comp = Compare{}) : comp_(comp) {
+        build(std::vector<T>(first, last));
+    }
+
+    template<typename Container>
+    explicit StaticBTree(const Container& sorted, const Compare& comp = Compare{})
+        : StaticBTree(std::begin(sorted), std::end(sorted), comp) {}
+
+    std::size_t size()  const { return size_; }
+    bool        empty() const { return size_ == 0; }
+
+    //! Index of the first key not less than x (size() if none)
+    std::size_t lower_bound_index(const T& x) const {
+        return search(x, [this](const T& key, const T& v) { return comp_(key, v); });
+    }
+
+    //! Index of the first key greater than x (size() if none)
+    std::size_t upper_bound_index(const T& x) const {
+        return search(x, [this](const T& key, const T& v) { return !comp_(v, key); });
+    }
+
+    //! Batched lookups : the queries go down the tree together one level at a time, the
+    //! block of every query is prefetched before any is read so the misses overlap
+    template<typename InputIt, typename OutputIt>
+    void lower_bound_indices(InputIt first, InputIt last, OutputIt out) const {
+        search_batch(first, last, out, [this](const T& key, const T& v) { return comp_(key, v); });
+    }
+
+    template<typename InputIt, typename OutputIt>
+    void upper_bound_indices(InputIt first, InputIt last, OutputIt out) const {
+        search_batch(first, last, out, [this](const T& key, const T& v) { return !comp_(v, key); });
+    }
+
+    std::vector<std::size_t> lower_bound_indices(const std::vector<T>& queries) const {
+        std::vector<std::size_t> out(queries.size());
+        lower_bound_indices(queries.begin(), queries.end(), out.begin());
+        return out;
+    }
+
+    std::vector<std::size_t> upper_bound_indices(const std::vector<T>& queries) const {
+        std::vector<std::size_t> out(queries.size());
+        upper_bound_indices(queries.begin(), queries.end(), out.begin());
+        return out;
+    }
+
+private:
+    static constexpr std::size_t k_batch = 32;
+
+    void build(std::vector<T> keys) {
+        Precondition(std::is_sorted(keys.begin(), keys.end(), comp_), "StaticBTree: keys must be sorted!");
+        size_ = keys.size();
+        if (keys.empty()) { return; }
+        levels_.push_back(pad(std::move(keys)));
+        while (levels_.back().size() > B) {
+            auto const& below = levels_.back();
+            std::vector<T> level;
+            level.reserve(below.size() / B + B);
+            for (std::size_t b = B - 1; b < below.size(); b += B) { level.push_back(below[b]); }
+            levels_.push_back(pad(std::move(level)));
+        }
+    }
+
+    // blocks are completed with copies of the largest key : never below a query which is
+    // not above everything, and results past the real keys are clamped to size()
+    static std::vector<T> pad(std::vector<T> level) {
+        auto last = level.back();
+        level.resize((level.size() + B - 1) / B * B, last);
+        return level;
+    }
+
+    template<typename Below>
+    static std::size_t count_block(const T* block, const T& x, Below below) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < B; i ++) { n += below(block[i], x) ? 1 : 0; }
+        return n;
+    }
+
+    template<typename Below>
+    std::size_t search(const T& x, Below below) const {
+        if (size_ == 0) { return 0; }
+        std::size_t j = 0;
+        for (auto l = levels_.size(); l-- > 0; ) {
+            auto const& level = levels_[l];
+            auto base = std::min(j, level.size() / B - 1) * B;
+            j = base + count_block(level.data() + base, x, below);
+        }
+        return std::min(j, size_);
+    }
+
+    template<typename InputIt, typename OutputIt, typename Below>
+    void search_batch(InputIt first, InputIt last, OutputIt out, Below below) const {
+        std::vector<T> x;
+        x.reserve(k_batch);
+        std::size_t j[k_batch];
+        while (first != last) {
+            x.clear();
+            for (; first != last && x.size() < k_batch; ++ first) { x.push_back(*first); }
+            auto n = x.size();
+            if (size_ == 0) {
+                for (std::size_t q = 0; q < n; q ++) { *out++ = 0; }
+                continue;
+            }
+            std::fill(j, j + n, std::size_t{0});
+            for (auto l = levels_.size(); l-- > 0; ) {
+                auto const& level = levels_[l];
+                auto blocks = level.size() / B;
+                for (std::size_t q = 0; q < n; q ++) {
+                    j[q] = std::min(j[q], blocks - 1) * B;
+                    prefetch(level.data() + j[q]);
+                }
+                for (std::size_t q = 0; q < n; q ++) {
+                    j[q] += count_block(level.data() + j[q], x[q], below);
+                }
+            }
+            for (std::size_t q = 0; q < n; q ++) { *out++ = std::min(j[q], size_); }
+        }
+    }
+
+    static void prefetch(const T* block) {
+#if defined(__GNUC__)
+        for (std::size_t off = 0; off < B * sizeof(T); off += 64) {
+            __builtin_prefetch(reinterpret_cast<const char*>(block) + off);
+        }
+#else
+        (void)block;
+#endif
+    }
+
+    std::vector<std::vector<T>> levels_; // levels_[0] : sorted keys, levels_.back() : root block
+    std::size_t                 size_{0};
+    Compare                     comp_;
+};
+
+} // ns _impl_static_btree
+
+using _impl_static_btree::StaticBTree;
+
+} // ns coin
@@ -0,0 +1,476 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "except.hpp"
+#include "thread_guard.hpp"
+
+namespace coin {
+
+namespace _impl_pool {
+
+constexpr std::size_t k_cache_line = 64;
+
+struct Task {
+    virtual ~Task() = default;
+    virtual void run() = 0;
+};
+
+template<typename F>
+struct TaskImpl final : Task {
+    explicit TaskImpl(F&& f) : func(std::move(f)) {}
+    void run() override { func(); }
+    F func;
+};
+
+template<typename F>
+Task* make_task(F&& f) {
+    return new TaskImpl<std::decay_t<F>>(std::forward<F>(f));
+}
+
+
+//! Chase-Lev work stealing deque of fixed capacity (power of two).
+//! Only the owner thread calls push() and pop() (LIFO end), any thread may steal() (FIFO end).
+//! Memory orderings follow Le, Pop, Cohen, Zappa Nardelli, PPoPP 2013.
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(std::size_t capacity = 4096)
+        : mask_{round_capacity(capacity) - 1}
+        , buffer_{new std::atomic<Task*>[mask_ + 1]} {}
+
+    WorkStealingDeque(const WorkStealingDeque&)            = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    //! Return false when the deque is full
+    bool push(Task* task) {
+        auto b = bottom_.load(std::memory_order_relaxed);
+        auto t = top_.load(std::memory_order_acquire);
+        if (b - t > static_cast<std::int64_t>(mask_)) {
+            return false;
+        }
+        buffer_[b & mask_].store(task, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    Task* pop() {
+        auto b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_relaxed);
+        if (t > b) { // empty
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Task* task = buffer_[b & mask_].load(std::memory_order_relaxed);
+        if (t == b) { // last element, race against thieves
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task* steal() {
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        Task* task = buffer_[t & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr; // lost the race
+        }
+        return task;
+    }
+
+    bool empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static std::size_t round_capacity(std::size_t n) {
+        std::size_t c = 2;
+        while (c < n) { c <<= 1; }
+        return c;
+    }
+
+    // padded rather than alignas so that plain C++14 new keeps working
+    std::atomic<std::int64_t>             top_{0};
+    char                                  pad_top_[k_cache_line - sizeof(std::atomic<std::int64_t>)];
+    std::atomic<std::int64_t>             bottom_{0};
+    char                                  pad_bottom_[k_cache_line - sizeof(std::atomic<std::int64_t>)];
+    std::size_t                           mask_;
+    std::unique_ptr<std::atomic<Task*>[]> buffer_;
+};
+
+
+class ThreadPool;
+
+struct WorkerContext {
+    ThreadPool* pool{nullptr};
+    std::size_t index{0};
+};
+
+inline WorkerContext& current_worker() {
+    static thread_local WorkerContext context;
+    return context;
+}
+
+// run one pending task of the pool the current thread works for, if any (defined below)
+inline bool help_current_pool();
+
+
+//! Shared state between a Future and the task computing its value
+template<typename T>
+class FutureState {
+public:
+    FutureState() = default;
+    FutureState(const FutureState&) = delete;
+    ~FutureState() { if (has_value_) { reinterpret_cast<T*>(&storage_)->~T(); } }
+
+    template<typename... Args>
+    void set_value(Args&&... args) {
+        new (&storage_) T(std::forward<Args>(args)...);
+        has_value_ = true;
+        mark_ready();
+    }
+
+    T take() {
+        wait();
+        if (error_) { std::rethrow_exception(error_); }
+        return std::move(*reinterpret_cast<T*>(&storage_));
+    }
+
+    void set_exception(std::exception_ptr e) { error_ = e; mark_ready(); }
+    bool ready() const { return ready_.load(std::memory_order_acquire); }
+    void wait();
+
+protected:
+    void mark_ready() {
+        ready_.store(true, std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock{mutex_};
+            cv_.notify_all();
+        }
+    }
+
+    std::atomic<bool>       ready_{false};
+    std::atomic<int>        waiters_{0};
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    std::exception_ptr      error_;
+    bool                    has_value_{false};
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+};
+
+template<>
+class FutureState<void> : public FutureState<char> {
+public:
+    void set_value() { FutureState<char>::set_value('\0'); }
+    void take() { FutureState<char>::take(); }
+};
+
+template<typename T>
+void FutureState<T>::wait() {
+    if (ready()) { return; }
+    // a worker waiting on a future keeps executing tasks, so nested waits cannot deadlock the pool
+    if (current_worker().pool) {
+        while (!ready()) {
+            if (!help_current_pool()) { std::this_thread::yield(); }
+        }
+        return;
+    }
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        cv_.wait(lock, [this] { return ready(); });
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+//! Result of ThreadPool::submit(). Movable only; get() can be called once and rethrows
+//! the exception raised by the task if any.
+template<typename T>
+class Future {
+public:
+    Future() = default;
+    explicit Future(std::shared_ptr<FutureState<T>> state) : state_{std::move(state)} {}
+
+    bool valid() const { return state_ != nullptr; }
+    bool ready() const { return state_->ready(); }
+    void wait() const { state_->wait(); }
+
+    T get() {
+        auto state = std::move(state_);
+        return state->take();
+    }
+
+private:
+    std::shared_ptr<FutureState<T>> state_;
+};
+
+
+//! Fixed-size pool of workers, each owning a Chase-Lev deque.
+//! Tasks submitted from a worker go to its own deque, tasks submitted from outside go
+//! to a shared injection queue; idle workers steal from the others before sleeping.
+//! Workers are held by ThreadGuard (join action) : shutdown() or the destructor let
+//! already queued tasks finish, including the ones they submit, then join every thread.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency(),
+                        bool pin_threads = false,
+                        std::size_t deque_capacity = 4096) {
+        if (threads == 0) { threads = 1; }
+        deques_.reserve(threads);
+        for (std::size_t i = 0; i < threads; i ++) {
+            deques_.emplace_back(new WorkStealingDeque(deque_capacity));
+        }
+        workers_.reserve(threads);
+        for (std::size_t i = 0; i < threads; i ++) {
+            workers_.emplace_back(std::thread([this, i] { worker_loop(i); }), Action::join);
+            if (pin_threads) { pin(workers_.back().get(), i); }
+        }
+    }
+
+    ~ThreadPool() { shutdown(); }
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return deques_.size(); }
+
+    //! Fire and forget : func must not throw, an exception escaping it ends in std::terminate
+    //! on the worker (as for std::thread). Use submit() to get it back through the Future.
+    template<typename F>
+    void post(F&& func) {
+        enqueue(make_task(std::forward<F>(func)));
+    }
+
+    template<typename F, typename... Args>
+    auto submit(F&& func, Args&&... args) -> Future<std::result_of_t<std::decay_t<F>(std::decay_t<Args>...)>> {
+        using result_type = std::result_of_t<std::decay_t<F>(std::decay_t<Args>...)>;
+        auto state = std::make_shared<FutureState<result_type>>();
+        auto bound = std::bind(std::forward<F>(func), std::forward<Args>(args)...);
+        enqueue(make_task([state, bound = std::move(bound)]() mutable {
+            try {
+                run_and_set(*state, bound);
+            }
+            catch (...) {
+                state->set_exception(std::current_exception());
+            }
+        }));
+        return Future<result_type>{std::move(state)};
+    }
+
+    //! Call func(chunk_first, chunk_last) over [first,last) split in chunks of `grain` indices
+    //! (grain 0 : about 4 chunks per worker). The calling thread takes part in the loop.
+    template<typename F>
+    void parallel_for_chunks(std::size_t first, std::size_t last, std::size_t grain, F&& func) {
+        if (first >= last) { return; }
+        auto n = last - first;
+        if (grain == 0) { grain = std::max<std::size_t>(1, n / (size() * 4)); }
+        auto chunks = (n + grain - 1) / grain;
+        std::atomic<std::size_t> next{0};
+        auto body = [&] {
+            for (auto c = next.fetch_add(1); c < chunks; c = next.fetch_add(1)) {
+                auto b = first + c * grain;
+                func(b, std::min(last, b + grain));
+            }
+        };
+
+        auto helpers = std::min(chunks, size() + 1) - 1;
+        std::vector<Future<void>> futures;
+        futures.reserve(helpers);
+        for (std::size_t i = 0; i < helpers; i ++) {
+            futures.push_back(submit(body));
+        }
+        std::exception_ptr error;
+        try { body(); }
+        catch (...) { error = std::current_exception(); }
+        for (auto& f : futures) { f.wait(); } // body references locals, wait for everyone first
+        if (error) { std::rethrow_exception(error); }
+        for (auto& f : futures) { f.get(); }
+    }
+
+    //! Call func(i) for every i in [first,last)
+    template<typename F>
+    void parallel_for(std::size_t first, std::size_t last, std::size_t grain, F&& func) {
+        parallel_for_chunks(first, last, grain, [&func](std::size_t b, std::size_t e) {
+            for (auto i = b; i < e; i ++) { func(i); }
+        });
+    }
+
+    //! Finish queued tasks then join the workers. Tasks keep submitting (nested submit or
+    //! parallel_for) while the pool drains, submissions from other threads throw.
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock{sleep_mutex_};
+            if (stop_.exchange(true)) { return; }
+        }
+        sleep_cv_.notify_all();
+        workers_.clear(); // ThreadGuard joins
+    }
+
+    //! Run one queued task on the calling worker thread, false if none was found
+    bool run_one(std::size_t index) {
+        if (Task* task = take(index)) {
+            execute(task);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    template<typename R, typename B>
+    static std::enable_if_t<!std::is_void<R>::value> run_and_set(FutureState<R>& state, B& bound) {
+        state.set_value(bound());
+    }
+
+    template<typename R, typename B>
+    static std::enable_if_t<std::is_void<R>::value> run_and_set(FutureState<R>& state, B& bound) {
+        bound();
+        state.set_value();
+    }
+
+    static void pin(std::thread& t, std::size_t i) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        auto cpus = std::max(1u, std::thread::hardware_concurrency());
+        CPU_SET(i % cpus, &set);
+        pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+        (void)t;
+        (void)i;
+#endif
+    }
+
+    void enqueue(Task* task) {
+        std::unique_ptr<Task> owner{task};
+        auto& ctx = current_worker();
+        if (ctx.pool == this) {
+            // always accepted : the submitting worker stays in its loop until pending_ drops to 0
+            if (deques_[ctx.index]->push(task)) { owner.release(); }
+            else { inject(owner); }
+            pending_.fetch_add(1, std::memory_order_seq_cst);
+            if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock{sleep_mutex_};
+                sleep_cv_.notify_one();
+            }
+            return;
+        }
+        // under the lock shutdown() sets stop_ with and the workers check pending_ with before
+        // leaving : either the task is counted before the last worker looks, or it is refused
+        std::lock_guard<std::mutex> lock{sleep_mutex_};
+        Precondition(!stop_, "ThreadPool: submit after shutdown");
+        inject(owner);
+        pending_.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_seq_cst) > 0) { sleep_cv_.notify_one(); }
+    }
+
+    void inject(std::unique_ptr<Task>& task) {
+        std::lock_guard<std::mutex> lock{injection_mutex_};
+        injection_.push_back(task.get());
+        task.release();
+    }
+
+    Task* take(std::size_t index) {
+        if (Task* task = deques_[index]->pop()) { return task; }
+        {
+            std::lock_guard<std::mutex> lock{injection_mutex_};
+            if (!injection_.empty()) {
+                Task* task = injection_.front();
+                injection_.pop_front();
+                return task;
+            }
+        }
+        auto n = deques_.size();
+        for (std::size_t k = 1; k < n; k ++) {
+            if (Task* task = deques_[(index + k) % n]->steal()) { return task; }
+        }
+        return nullptr;
+    }
+
+    void execute(Task* task) {
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        std::unique_ptr<Task> owner{task};
+        owner->run();
+    }
+
+    void worker_loop(std::size_t index) {
+        current_worker() = WorkerContext{this, index};
+        for (;;) {
+            if (run_one(index)) { continue; }
+            bool found = false;
+            for (int spin = 0; spin < 64 && !found; spin ++) {
+                std::this_thread::yield();
+                found = pending_.load(std::memory_order_relaxed) > 0;
+            }
+            if (found) { continue; }
+
+            std::unique_lock<std::mutex> lock{sleep_mutex_};
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            sleep_cv_.wait(lock, [this] { return stop_ || pending_.load(std::memory_order_seq_cst) > 0; });
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            if (stop_ && pending_.load(std::memory_order_seq_cst) <= 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques_;
+    std::mutex                                      injection_mutex_;
+    std::deque<Task*>                               injection_;
+    // counters on their own lines, padded rather than aligned as in WorkStealingDeque
+    char                                            pad_pending_[k_cache_line];
+    std::atomic<std::int64_t>                       pending_{0};
+    char                                            pad_sleepers_[k_cache_line];
+    std::atomic<int>                                sleepers_{0};
+    char                                            pad_end_[k_cache_line];
+    std::mutex                                      sleep_mutex_;
+    std::condition_variable                         sleep_cv_;
+    std::atomic<bool>                               stop_{false};
+    std::vector<ThreadGuard>                        workers_; // last member : joined first
+};
+
+//! Process wide pool (one worker per hardware thread) used by the parallel algorithms
+inline ThreadPool& shared_thread_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+inline bool help_current_pool() {
+    auto& ctx = current_worker();
+    return ctx.pool && ctx.pool->run_one(ctx.index);
+}
+
+} // ns _impl_pool
+
+using _impl_pool::Future;
+using _impl_pool::ThreadPool;
+using _impl_pool::shared_thread_pool;
+using _impl_pool::WorkStealingDeque;
+
+} // ns coin
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define COIN_HAS_TSC 1
+#else
+#define COIN_HAS_TSC 0
+#endif
+
+namespace coin {
+
+namespace _impl_tsc {
+
+//! How rdtsc is ordered with respect to the surrounding instructions
+//! none   : plain rdtsc, cheapest but may be reordered with the measured code
+//! lfence : lfence; rdtsc; lfence
+//! rdtscp : rdtscp; lfence (waits for previous instructions to retire)
+enum class TscFence { none, lfence, rdtscp };
+
+//! Tell whether the cpu has an invariant TSC (constant rate across P/C-states)
+inline bool has_invariant_tsc() {
+#if COIN_HAS_TSC
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+template<TscFence Fence>
+inline std::uint64_t read_tsc() {
+#if COIN_HAS_TSC
+    switch (Fence) {
+    case TscFence::lfence: {
+        _mm_lfence();
+        std::uint64_t t = __rdtsc();
+        _mm_lfence();
+        return t;
+    }
+    case TscFence::rdtscp: {
+        unsigned aux;
+        std::uint64_t t = __rdtscp(&aux);
+        _mm_lfence();
+        return t;
+    }
+    default:
+        return __rdtsc();
+    }
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct TscCalibration {
+    bool          usable{false};
+    std::uint64_t origin{0};        // tsc value mapped to time_since_epoch() == offset_ns
+    double        offset_ns{0.0};
+    double        ns_per_tick{1.0};
+    double        ticks_per_second{0.0};
+};
+
+inline double tsc_to_ns(const TscCalibration& c, std::uint64_t tsc) {
+    return c.offset_ns + static_cast<double>(static_cast<std::int64_t>(tsc - c.origin)) * c.ns_per_tick;
+}
+
+//! Measure the TSC frequency against steady_clock over the given duration
+inline TscCalibration calibrate_tsc(std::chrono::nanoseconds duration = std::chrono::milliseconds(10)) {
+    TscCalibration calibration;
+    if (!has_invariant_tsc()) {
+        return calibration;
+    }
+    using steady = std::chrono::steady_clock;
+    auto steady_begin = steady::now();
+    auto tsc_begin = read_tsc<TscFence::lfence>();
+    std::this_thread::sleep_for(duration);
+    auto steady_end = steady::now();
+    auto tsc_end = read_tsc<TscFence::lfence>();
+
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_end - steady_begin).count();
+    if (elapsed_ns <= 0 || tsc_end <= tsc_begin) {
+        return calibration;
+    }
+    calibration.usable = true;
+    calibration.origin = tsc_begin;
+    calibration.ns_per_tick = static_cast<double>(elapsed_ns) / static_cast<double>(tsc_end - tsc_begin);
+    calibration.ticks_per_second = 1e9 / calibration.ns_per_tick;
+    return calibration;
+}
+
+//! Calibrations are never modified once published : readers load the current one without
+//! lock, calibrate() appends a new one (kept alive until exit) and swaps the pointer
+class TscCalibrationState {
+public:
+    TscCalibrationState() {
+        history_.push_back(calibrate_tsc());
+        current_.store(&history_.back(), std::memory_order_release);
+    }
+
+    const TscCalibration& current() const { return *current_.load(std::memory_order_acquire); }
+
+    //! The new rate takes over from the current reading of the clock with the same origin,
+    //! so now() keeps increasing across recalibrations
+    void recalibrate(std::chrono::nanoseconds duration) {
+        auto next = calibrate_tsc(duration);
+        if (!next.usable) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto& prev = current();
+        auto tsc = read_tsc<TscFence::lfence>();
+        auto now_ns = prev.usable
+            ? tsc_to_ns(prev, tsc)
+            : static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch()).count());
+        if (prev.usable) {
+            next.origin = prev.origin;
+        }
+        next.offset_ns = now_ns - static_cast<double>(static_cast<std::int64_t>(tsc - next.origin)) * next.ns_per_tick;
+        history_.push_back(next);
+        current_.store(&history_.back(), std::memory_order_release);
+    }
+
+private:
+    std::mutex                          mutex_;
+    std::deque<TscCalibration>          history_;
+    std::atomic<const TscCalibration*>  current_{nullptr};
+};
+
+inline TscCalibrationState& tsc_calibration_state() {
+    static TscCalibrationState state;
+    return state;
+}
+
+inline const TscCalibration& tsc_calibration() {
+    return tsc_calibration_state().current();
+}
+
+
+//! Clock reading the time stamp counter, usable as the Clock parameter of
+//! Timer, TimerScope and TimerFunc. The first use calibrates the frequency
+//! against steady_clock (~10 ms), call calibrate() up front to avoid it in a hot path.
+//! calibrate() may run while other threads call now().
+//! Without an invariant TSC it falls back to steady_clock.
+template<TscFence Fence = TscFence::none>
+struct basic_tsc_clock {
+    using rep        = std::int64_t;
+    using period     = std::nano;
+    using duration   = std::chrono::nanoseconds;
+    using time_point = std::chrono::time_point<basic_tsc_clock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept {
+        const auto& c = tsc_calibration();
+        if (!c.usable) {
+            return time_point{std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch())};
+        }
+        return time_point{duration{static_cast<rep>(tsc_to_ns(c, read_tsc<Fence>()))}};
+    }
+
+    //! Raw counter value, no conversion
+    static std::uint64_t ticks() noexcept { return read_tsc<Fence>(); }
+
+    static bool   is_tsc()    { return tsc_calibration().usable; }
+    static double frequency() { return tsc_calibration().ticks_per_second; }
+
+    static void calibrate(std::chrono::nanoseconds duration = std::chrono::milliseconds(10)) {
+        tsc_calibration_state().recalibrate(duration);
+    }
+};
+
+template<TscFence Fence> constexpr bool basic_tsc_clock<Fence>::is_steady;
+
+using tsc_clock        = basic_tsc_clock<TscFence::none>;
+using tsc_clock_fenced = basic_tsc_clock<TscFence::rdtscp>;
+
+} // ns _impl_tsc
+
+using _impl_tsc::TscFence;
+using _impl_tsc::has_invariant_tsc;
+using _impl_tsc::basic_tsc_clock;
+using _impl_tsc::tsc_clock;
+using _impl_tsc::tsc_clock_fenced;
+
+} // ns coin